@@ -1,7 +1,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <errno.h>
 #include <time.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // =================== STRUCT DEFINITIONS ===================
 
@@ -11,15 +29,25 @@ typedef struct Author {
     char firstName[50];
     char lastName[50];
     struct Author* next;
+    struct Author* nextSameName; // other authors with this first name, by ID
 } Author;
 
+// One line of KitapYazar.csv. Each mapping sits on three lists: all
+// mappings in file order, the book's authors and the author's books.
 typedef struct BookAuthor {
     char isbn[14];
     int authorID;
+    struct BookAuthor* next;
+    struct BookAuthor* prev;
+    struct BookAuthor* nextForBook;
+    struct BookAuthor* prevForBook;
+    struct BookAuthor* nextForAuthor;
+    struct BookAuthor* prevForAuthor;
 } BookAuthor;
 
 typedef struct {
-    BookAuthor* list;
+    BookAuthor* first;   // in KitapYazar.csv order
+    BookAuthor* last;
     int count;
 } BookAuthorManager;
 
@@ -29,15 +57,18 @@ typedef struct Student {
     char firstName[50];
     char lastName[50];
     int points;
+    int holder;  // handle stored in the copies this student has borrowed
     struct Student* next;
     struct Student* prev;
 } Student;
 
 // --- BookCopy Struct ---
+// Copies live in one array per book. The label (ISBN_1, ISBN_2, etc.) is
+// generated from the book when printed, see copyLabel().
 typedef struct BookCopy {
-    char label[30];       // ISBN_1, ISBN_2, etc.
-    char status[20];      // "RAFTA" or student ID
-    struct BookCopy* next;
+    int number;          // N in ISBN_N
+    int holder;          // 0 = "RAFTA", else an interned student ID, see holderKey()
+    unsigned char dirty; // status changed since Kitaplar.csv was written
 } BookCopy;
 
 // --- Book Struct ---
@@ -45,7 +76,11 @@ typedef struct Book {
     char title[100];
     char isbn[14];        // 13 digits + null terminator
     int quantity;
-    BookCopy* copies;
+    BookCopy* copies;     // copies[n - 1] is the copy labelled ISBN_n
+    int copyCount;
+    unsigned long long* onShelf; // bit i set: copies[i] is "RAFTA"
+    int onShelfCount;
+    long copiesOffset;    // start of the copy lines in Kitaplar.csv, -1 if not fixed-width
     struct Book* next;
 } Book;
 
@@ -54,10 +89,20 @@ typedef struct LoanRecord {
     char studentID[9];
     char label[30];   // KitapEtiketNO
     int type;         // 0 = loan, 1 = return
-    char date[11];    // DD-MM-YYYY
+    int day;          // days since 01-01-1970, shown as DD-MM-YYYY
     struct LoanRecord* next;
+    int openSlot;     // position in the due-date heap of open loans, -1 if not open
 } LoanRecord;
 
+// --- Everything main loads at startup ---
+typedef struct {
+    Author* authors;
+    Student* students;
+    Book* books;
+    LoanRecord* loans;
+    BookAuthorManager manager;
+} Library;
+
 // =================== FUNCTION POINTER STRUCTS ===================
 
 typedef void (*StudentOpFunc)(Student**, LoanRecord**, Book*);
@@ -82,1223 +127,5311 @@ typedef struct {
     BookOpFunc func;
 } BookOperation;
 
-void writeStudentsToFile(Student* head);
-void writeBooksToFile(Book* head);
-void writeLoansToFile(LoanRecord* head);
+// =================== MEMORY POOLS ===================
 
-Student* addStudent(Student* head, char* id, char* first, char* last);
+// Entities are carved out of large slabs instead of one malloc per record,
+// which keeps list nodes close together. Freed nodes go onto a free list
+// and are reused by the next allocation of the same type.
+typedef struct PoolSlab {
+    struct PoolSlab* next;
+    double align;  // objects start at a suitably aligned offset
+} PoolSlab;
 
-int studentExists(Student* head, const char* id) {
-    while (head) {
-        if (strcmp(head->id, id) == 0) {
-            return 1;  // ID already exists
-        }
-        head = head->next;
+typedef struct {
+    size_t objectSize;
+    size_t slabObjects;  // objects in the next slab; doubles up to POOL_MAX_SLAB
+    PoolSlab* slabs;
+    char* cursor;        // next unused object in the newest slab
+    char* end;
+    void* freeList;
+} Pool;
+
+#define POOL_FIRST_SLAB 256
+#define POOL_MAX_SLAB 65536
+#define POOL_INIT(type) { (sizeof(type) + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*), POOL_FIRST_SLAB, NULL, NULL, NULL, NULL }
+
+void* poolAlloc(Pool* pool) {
+    if (pool->freeList) {
+        void* p = pool->freeList;
+        pool->freeList = *(void**)p;
+        return p;
     }
-    return 0;
+    if (pool->cursor == pool->end) {
+        PoolSlab* slab = malloc(offsetof(PoolSlab, align) + pool->slabObjects * pool->objectSize);
+        if (!slab) return NULL;
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->cursor = (char*)slab + offsetof(PoolSlab, align);
+        pool->end = pool->cursor + pool->slabObjects * pool->objectSize;
+        if (pool->slabObjects < POOL_MAX_SLAB) pool->slabObjects *= 2;
+    }
+    void* p = pool->cursor;
+    pool->cursor += pool->objectSize;
+    return p;
 }
-LoanRecord* addLoanRecord(LoanRecord* head, const char* studentID, const char* label, int type, const char* date);
 
-int borrowBook(Student* studentList, Book* bookList, LoanRecord** loanList, const char* studentID, const char* isbn, const char* date) {
-    // 1. Check student exists
-    Student* s = studentList;
-    while (s && strcmp(s->id, studentID) != 0) s = s->next;
-    if (!s) {
-        printf("Student not found.\n");
-        return 0;
-    }
+void poolFree(Pool* pool, void* p) {
+    if (!p) return;
+    *(void**)p = pool->freeList;
+    pool->freeList = p;
+}
 
-    if (s->points <= 0) {
-        printf("Student has insufficient points.\n");
-        return 0;
-    }
+static Pool studentPool = POOL_INIT(Student);
+static Pool bookPool = POOL_INIT(Book);
+static Pool authorPool = POOL_INIT(Author);
+static Pool loanPool = POOL_INIT(LoanRecord);
+static Pool mappingPool = POOL_INIT(BookAuthor);
 
-    // 2. Find a free copy of the book
-    Book* b = bookList;
-    while (b && strcmp(b->isbn, isbn) != 0) b = b->next;
-    if (!b) {
-        printf("Book not found.\n");
-        return 0;
-    }
+// =================== HASH INDEXES ===================
 
-    BookCopy* copy = b->copies;
-    while (copy && strcmp(copy->status, "RAFTA") != 0) copy = copy->next;
+// --- String-keyed hash index (open addressing) ---
+// Keys are not copied: they point into the indexed record (e.g. Student.id),
+// so a record must be removed from the index before it is freed.
+typedef struct {
+    const char* key;
+    void* value;
+} IndexSlot;
 
-    if (!copy) {
-        printf("OPERATION FAILED: All copies are currently borrowed.\n");
-        return 0;
+typedef struct {
+    IndexSlot* slots;
+    size_t capacity;  // always a power of two
+    size_t count;     // live entries
+    size_t used;      // live entries + tombstones
+} StringIndex;
+
+static const char indexTombstone[] = "";
+#define INDEX_TOMBSTONE indexTombstone
+
+unsigned int hashString(const char* s) {
+    unsigned int h = 2166136261u;  // FNV-1a
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
     }
+    return h;
+}
 
-    // 3. Mark as borrowed
-    strcpy(copy->status, studentID);
+void* indexFind(const StringIndex* index, const char* key) {
+    if (index->capacity == 0) return NULL;
+    size_t mask = index->capacity - 1;
+    size_t i = hashString(key) & mask;
+    while (index->slots[i].key) {
+        if (index->slots[i].key != INDEX_TOMBSTONE && strcmp(index->slots[i].key, key) == 0)
+            return index->slots[i].value;
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
 
-    // 4. Record transaction
-  *loanList = addLoanRecord(*loanList, studentID, copy->label, 0, date);
+void indexInsert(StringIndex* index, const char* key, void* value);
 
+void indexGrow(StringIndex* index) {
+    IndexSlot* old = index->slots;
+    size_t oldCapacity = index->capacity;
+    size_t i;
 
-    writeLoansToFile(*loanList);
-    writeBooksToFile(bookList);
+    // Sized from live entries only, so rehashing also drops the tombstones
+    index->capacity = 64;
+    while (index->capacity <= (index->count + 1) * 2) index->capacity *= 2;
+    index->slots = calloc(index->capacity, sizeof(IndexSlot));
+    index->count = 0;
+    index->used = 0;
 
-    printf("Book %s successfully borrowed by %s.\n", copy->label, studentID);
-    return 1;
+    for (i = 0; i < oldCapacity; i++) {
+        if (old[i].key && old[i].key != INDEX_TOMBSTONE)
+            indexInsert(index, old[i].key, old[i].value);
+    }
+    free(old);
 }
 
-int returnBook(Student* studentList, Book* bookList, LoanRecord** loanList, const char* studentID, const char* label, const char* returnDate) {
-    // 1. Check student exists
-    Student* s = studentList;
-    while (s && strcmp(s->id, studentID) != 0) s = s->next;
-    if (!s) {
-        printf("Student not found.\n");
-        return 0;
+// Adds key -> value. If the key is already indexed the existing entry wins,
+// matching the first-match behaviour of the list scans this replaces.
+void indexInsert(StringIndex* index, const char* key, void* value) {
+    if ((index->used + 1) * 4 >= index->capacity * 3) indexGrow(index);
+
+    size_t mask = index->capacity - 1;
+    size_t i = hashString(key) & mask;
+    size_t firstFree = (size_t)-1;
+    while (index->slots[i].key) {
+        if (index->slots[i].key == INDEX_TOMBSTONE) {
+            if (firstFree == (size_t)-1) firstFree = i;
+        } else if (strcmp(index->slots[i].key, key) == 0) {
+            return;
+        }
+        i = (i + 1) & mask;
     }
+    if (firstFree != (size_t)-1) i = firstFree;
+    else index->used++;
+    index->slots[i].key = key;
+    index->slots[i].value = value;
+    index->count++;
+}
 
-    // 2. Find the book copy
-    Book* b = bookList;
-    BookCopy* c = NULL;
-    while (b) {
-        c = b->copies;
-        while (c) {
-            if (strcmp(c->label, label) == 0) break;
-            c = c->next;
+// Removes key only if it currently maps to value (a duplicate record that
+// never made it into the index must not evict the one that did).
+void indexRemove(StringIndex* index, const char* key, void* value) {
+    if (index->capacity == 0) return;
+    size_t mask = index->capacity - 1;
+    size_t i = hashString(key) & mask;
+    while (index->slots[i].key) {
+        if (index->slots[i].key != INDEX_TOMBSTONE && strcmp(index->slots[i].key, key) == 0) {
+            if (index->slots[i].value == value) {
+                index->slots[i].key = INDEX_TOMBSTONE;
+                index->slots[i].value = NULL;
+                index->count--;
+            }
+            return;
         }
-        if (c) break;
-        b = b->next;
+        i = (i + 1) & mask;
     }
+}
 
-    if (!c) {
-        printf("Book copy not found.\n");
-        return 0;
+// --- Integer-keyed hash index (open addressing) ---
+// Same rules as StringIndex: the existing entry wins on insert and a key
+// is only removed while it still maps to the given value.
+typedef struct {
+    int key;
+    int state;  // 0 = empty, 1 = live, 2 = tombstone
+    void* value;
+} IntIndexSlot;
+
+typedef struct {
+    IntIndexSlot* slots;
+    size_t capacity;  // always a power of two
+    size_t count;     // live entries
+    size_t used;      // live entries + tombstones
+} IntIndex;
+
+size_t hashInt(int key) {
+    return (unsigned int)key * 2654435761u;
+}
+
+void* intIndexFind(const IntIndex* index, int key) {
+    if (index->capacity == 0) return NULL;
+    size_t mask = index->capacity - 1;
+    size_t i = hashInt(key) & mask;
+    while (index->slots[i].state) {
+        if (index->slots[i].state == 1 && index->slots[i].key == key) return index->slots[i].value;
+        i = (i + 1) & mask;
     }
+    return NULL;
+}
 
-    if (strcmp(c->status, studentID) != 0) {
-        printf("This book is not borrowed by this student.\n");
-        return 0;
+void intIndexInsert(IntIndex* index, int key, void* value) {
+    if ((index->used + 1) * 4 >= index->capacity * 3) {
+        IntIndexSlot* old = index->slots;
+        size_t oldCapacity = index->capacity;
+        size_t i;
+        index->capacity = 64;
+        while (index->capacity <= (index->count + 1) * 2) index->capacity *= 2;
+        index->slots = calloc(index->capacity, sizeof(IntIndexSlot));
+        index->count = 0;
+        index->used = 0;
+        for (i = 0; i < oldCapacity; i++) {
+            if (old[i].state == 1) intIndexInsert(index, old[i].key, old[i].value);
+        }
+        free(old);
     }
 
-    // 3. Find matching loan date
-    LoanRecord* l = *loanList;
-    LoanRecord* match = NULL;
-    while (l) {
-        if (l->type == 0 && strcmp(l->label, label) == 0 && strcmp(l->studentID, studentID) == 0) {
-            match = l;
+    size_t mask = index->capacity - 1;
+    size_t i = hashInt(key) & mask;
+    size_t firstFree = (size_t)-1;
+    while (index->slots[i].state) {
+        if (index->slots[i].state == 2) {
+            if (firstFree == (size_t)-1) firstFree = i;
+        } else if (index->slots[i].key == key) {
+            return;
         }
-        l = l->next;
+        i = (i + 1) & mask;
     }
+    if (firstFree != (size_t)-1) i = firstFree;
+    else index->used++;
+    index->slots[i].key = key;
+    index->slots[i].state = 1;
+    index->slots[i].value = value;
+    index->count++;
+}
 
-    // 4. Calculate delay
-    if (match) {
-        int days = daysBetween(match->date, returnDate);
-        if (days > 15) {
-            printf("Returned late. -10 penalty applied.\n");
-            s->points -= 10;
-            if (s->points < 0) s->points = 0;
-            writeStudentsToFile(studentList);
+void intIndexRemove(IntIndex* index, int key, void* value) {
+    if (index->capacity == 0) return;
+    size_t mask = index->capacity - 1;
+    size_t i = hashInt(key) & mask;
+    while (index->slots[i].state) {
+        if (index->slots[i].state == 1 && index->slots[i].key == key) {
+            if (index->slots[i].value == value) {
+                index->slots[i].state = 2;
+                index->slots[i].value = NULL;
+                index->count--;
+            }
+            return;
         }
+        i = (i + 1) & mask;
     }
+}
 
-    // 5. Mark book as on shelf
-    strcpy(c->status, "RAFTA");
+// =================== LOCKING ===================
+
+// Only the daemon runs several threads; it sets lockingEnabled before its
+// first client is accepted, so everywhere else these helpers cost nothing.
+//  - libraryLock: shared for queries and transactions, exclusive for
+//    anything that changes the lists or indexes (add student/book, ...)
+//  - stripes: one student stripe and one book stripe per transaction, so
+//    borrows/returns on different students and books run in parallel
+//  - writeLock: held by whoever is writing pending commits to the files,
+//    so they go out in order; taken before the commit lock
+//  - commitLock: innermost; guards the shared loan log, the dirty queue and
+//    the fields transactions change (copy status, points). It is only held
+//    while memory changes, never across file I/O on the commit path.
+#define LOCK_STRIPES 64
+static int lockingEnabled;
+
+#ifndef _WIN32
+static pthread_rwlock_t libraryLock;
+static pthread_mutex_t writeLock;
+static pthread_mutex_t commitLock;
+static pthread_mutex_t studentStripes[LOCK_STRIPES];
+static pthread_mutex_t bookStripes[LOCK_STRIPES];
+
+void initLocking(void) {
+    int i;
+    pthread_rwlock_init(&libraryLock, NULL);
+    pthread_mutex_init(&writeLock, NULL);
+    pthread_mutex_init(&commitLock, NULL);
+    for (i = 0; i < LOCK_STRIPES; i++) {
+        pthread_mutex_init(&studentStripes[i], NULL);
+        pthread_mutex_init(&bookStripes[i], NULL);
+    }
+    lockingEnabled = 1;
+}
 
-    // 6. Record return
-   *loanList = addLoanRecord(*loanList, studentID, label, 1, returnDate);
+void lockLibrary(int exclusive) {
+    if (!lockingEnabled) return;
+    if (exclusive) pthread_rwlock_wrlock(&libraryLock);
+    else pthread_rwlock_rdlock(&libraryLock);
+}
 
+void unlockLibrary(void) {
+    if (lockingEnabled) pthread_rwlock_unlock(&libraryLock);
+}
 
-    writeLoansToFile(*loanList);
-    writeBooksToFile(bookList);
+void lockWrites(void) {
+    if (lockingEnabled) pthread_mutex_lock(&writeLock);
+}
 
-    printf("Book %s successfully returned.\n", label);
-    return 1;
+void unlockWrites(void) {
+    if (lockingEnabled) pthread_mutex_unlock(&writeLock);
 }
- 
 
- 
- // Author function prototypes
-Author* addAuthor(Author* head, char* first, char* last);
-void writeAuthorsToFile(Author* head);
-Author* deleteAuthor(Author* head, int id, BookAuthorManager* manager);
-Author* readAuthorsFromFile(void);
-void viewAuthorInfo(const char* firstName, Author* authorList, Book* bookList, BookAuthorManager* manager);
-Author* updateAuthor(Author* head, int id);
+void lockCommit(void) {
+    if (lockingEnabled) pthread_mutex_lock(&commitLock);
+}
 
-// student functions  prototypes 
-void showStudentInfo(Student* head, LoanRecord* loans,  const char* id);
-void listStudentsWithUnreturnedBooks(Student* students, LoanRecord* loans);
-void listPenalizedStudents(Student* students, LoanRecord* loans);
-void listAllStudents(Student* students);
+void unlockCommit(void) {
+    if (lockingEnabled) pthread_mutex_unlock(&commitLock);
+}
 
+// Stripes are keyed by student ID / ISBN. Always take a student stripe
+// before a book stripe, and never hold two of the same kind.
+void lockStudent(const char* id) {
+    if (lockingEnabled) pthread_mutex_lock(&studentStripes[hashString(id) % LOCK_STRIPES]);
+}
 
-// book function prototypes
+void unlockStudent(const char* id) {
+    if (lockingEnabled) pthread_mutex_unlock(&studentStripes[hashString(id) % LOCK_STRIPES]);
+}
 
-Book* addBook(Book* head, char* title, char* isbn, int quantity);
-Book* deleteBookByISBN(Book* head, const char* isbn);
-int updateBookTitle(Book* head, const char* isbn, const char* newTitle);
-void showBookInfoByTitle(Book* head, const char* title);
-void listBooksOnShelf(Book* head);
-void listOverdueBooks(LoanRecord* loans);
+void lockBook(const char* isbn) {
+    if (lockingEnabled) pthread_mutex_lock(&bookStripes[hashString(isbn) % LOCK_STRIPES]);
+}
 
+void unlockBook(const char* isbn) {
+    if (lockingEnabled) pthread_mutex_unlock(&bookStripes[hashString(isbn) % LOCK_STRIPES]);
+}
+#else
+void lockLibrary(int exclusive) {}
+void unlockLibrary(void) {}
+void lockWrites(void) {}
+void unlockWrites(void) {}
+void lockCommit(void) {}
+void unlockCommit(void) {}
+void lockStudent(const char* id) {}
+void unlockStudent(const char* id) {}
+void lockBook(const char* isbn) {}
+void unlockBook(const char* isbn) {}
+#endif
+
+// Where the library functions print; the daemon points it at the client.
+#ifdef _MSC_VER
+static __declspec(thread) FILE* replyStream;
+#else
+static __thread FILE* replyStream;
+#endif
+#define OUT (replyStream ? replyStream : stdout)
+
+// --- Student ID -> Student* ---
+static StringIndex studentIndex;
+
+Student* findStudent(const char* id) {
+    return indexFind(&studentIndex, id);
+}
 
-typedef void (*AuthorOpFunc)(Author**, BookAuthorManager*, Book*) ; 
+// --- Interned keys ---
+// Maps short strings (student IDs, copy labels) to dense integer handles
+// starting at 1, so hot structures can store and compare ints instead.
+// Handles are never released.
+typedef struct {
+    char key[30];
+    int handle;
+} InternedKey;
 
-  void op_addAuthor(Author** list, BookAuthorManager* manager, Book* bookList) {
-    char first[50], last[50];
-    printf("Enter first name: ");
-    scanf("%s", first);
-    printf("Enter last name: ");
-    scanf("%s", last);
-    *list = addAuthor(*list, first, last);
-    writeAuthorsToFile(*list);
-    printf("Author added.\n");
+typedef struct {
+    StringIndex index;
+    InternedKey** keys;  // keys[handle]; keys[0] is unused
+    int count;
+    int capacity;
+} Interner;
+
+static Pool internPool = POOL_INIT(InternedKey);
+#ifndef _WIN32
+static pthread_mutex_t internMutex = PTHREAD_MUTEX_INITIALIZER; // the loader interns from several threads
+#endif
+
+int internKey(Interner* in, const char* key) {
+    char buf[30];
+    snprintf(buf, sizeof(buf), "%s", key);
+#ifndef _WIN32
+    pthread_mutex_lock(&internMutex);
+#endif
+    InternedKey* k = indexFind(&in->index, buf);
+    if (!k) {
+        if (in->count + 1 >= in->capacity) {
+            in->capacity = in->capacity ? in->capacity * 2 : 1024;
+            in->keys = realloc(in->keys, in->capacity * sizeof(InternedKey*));
+        }
+        k = poolAlloc(&internPool);
+        strcpy(k->key, buf);
+        k->handle = ++in->count;
+        in->keys[k->handle] = k;
+        indexInsert(&in->index, k->key, k);
+    }
+#ifndef _WIN32
+    pthread_mutex_unlock(&internMutex);
+#endif
+    return k->handle;
 }
 
+// --- Copy holders ---
+// A borrowed copy stores a small handle instead of the borrower's ID. Every
+// student ID is interned when the student is added, so borrowing and
+// returning compare handles; other statuses found in Kitaplar.csv are
+// interned as they are read.
+static Interner holders;
 
-void op_deleteAuthor(Author** list, BookAuthorManager* manager,Book* bookList) {
-    int id;
-    printf("Enter author ID to delete: ");
-    scanf("%d", &id);
-    *list = deleteAuthor(*list, id, manager);
+int internHolder(const char* key) {
+    if (strcmp(key, "RAFTA") == 0) return 0;
+    return internKey(&holders, key);
 }
 
-void op_updateAuthor(Author** list, BookAuthorManager* manager,Book* bookList) {
-    int id;
-    printf("Enter author ID to update: ");
-    scanf("%d", &id);
-    updateAuthor(*list, id);
-    writeAuthorsToFile(*list);
+const char* holderKey(int handle) {
+    return handle ? holders.keys[handle]->key : "RAFTA";
 }
 
-void op_viewAuthor(Author** list, BookAuthorManager* manager, Book* bookList) {
-    char first[50];
-    printf("Enter author's first name: ");
-    scanf("%s", first);
-    viewAuthorInfo(first, *list, bookList, manager);
-}
+// --- Author ID -> Author*, first name -> Author* (lowest ID first) ---
+static IntIndex authorIndex;
+static StringIndex authorNameIndex;
 
-void op_listAllAuthors(Author** list, BookAuthorManager* manager,Book* bookList) {
-    printf("\n--- ALL AUTHORS ---\n");
-    Author* a;
-    for (a = *list; a != NULL; a = a->next) {
-        printf("ID: %d | Name: %s %s\n", a->id, a->firstName, a->lastName);
-    }
+Author* findAuthor(int id) {
+    return intIndexFind(&authorIndex, id);
 }
 
+Author* findAuthorByFirstName(const char* firstName) {
+    return indexFind(&authorNameIndex, firstName);
+}
 
-// =================== Author Functions ===================
-Author* addAuthor(Author* head, char* first, char* last) {
-    Author* newAuthor = malloc(sizeof(Author));
+void indexAuthor(Author* a) {
+    intIndexInsert(&authorIndex, a->id, a);
 
-    // Find the current maximum ID in the list
-    int maxID = 0;
-    Author* temp = head;
-    while (temp != NULL) {
-        if (temp->id > maxID) maxID = temp->id;
-        temp = temp->next;
+    Author* head = indexFind(&authorNameIndex, a->firstName);
+    if (!head || a->id < head->id) {
+        a->nextSameName = head;
+        if (head) indexRemove(&authorNameIndex, head->firstName, head);
+        indexInsert(&authorNameIndex, a->firstName, a);
+        return;
     }
+    while (head->nextSameName && head->nextSameName->id < a->id) head = head->nextSameName;
+    a->nextSameName = head->nextSameName;
+    head->nextSameName = a;
+}
 
-    newAuthor->id = maxID + 1; // Assign next ID
-    strcpy(newAuthor->firstName, first);
-    strcpy(newAuthor->lastName, last);
-    newAuthor->next = NULL;
-
-    // Insert into sorted list (keep your existing code here)
-    if (!head) return newAuthor;
+// Must be called with the name the author was indexed under.
+void unindexAuthor(Author* a) {
+    intIndexRemove(&authorIndex, a->id, a);
 
-    Author* current = head;
-    Author* prev = NULL;
-    while (current && current->id < newAuthor->id) {
-        prev = current;
-        current = current->next;
-    }
-    if (!prev) {
-        newAuthor->next = head;
-        return newAuthor;
+    Author* head = indexFind(&authorNameIndex, a->firstName);
+    if (head == a) {
+        indexRemove(&authorNameIndex, a->firstName, a);
+        if (a->nextSameName) indexInsert(&authorNameIndex, a->nextSameName->firstName, a->nextSameName);
+    } else {
+        while (head && head->nextSameName != a) head = head->nextSameName;
+        if (head) head->nextSameName = a->nextSameName;
     }
-    prev->next = newAuthor;
-    newAuthor->next = current;
-    return head;
+    a->nextSameName = NULL;
 }
 
-void addBookAuthorMapping(BookAuthorManager* manager, const char* isbn, int authorID) {
-    manager->list = realloc(manager->list, (manager->count + 1) * sizeof(BookAuthor));
-    strcpy(manager->list[manager->count].isbn, isbn);
-    manager->list[manager->count].authorID = authorID;
-    manager->count++;
+// --- ISBN -> Book* ---
+static StringIndex bookIndex;
+
+Book* findBook(const char* isbn) {
+    return indexFind(&bookIndex, isbn);
 }
 
-void writeBookAuthorCSV(BookAuthorManager* manager) {
-    FILE* f = fopen("KitapYazar.csv", "w");
-    if (!f) {
-        printf("Couldn't write to KitapYazar.csv\n");
-        return;
-    }
-    int i;
-    for (i = 0; i < manager->count; i++) {
-        fprintf(f, "%s,%d\n", manager->list[i].isbn, manager->list[i].authorID);
+// --- Copies ---
+// out must hold at least 30 bytes.
+char* copyLabel(const Book* b, const BookCopy* c, char* out) {
+    sprintf(out, "%s_%d", b->isbn, c->number);
+    return out;
 }
-    fclose(f);
+
+const char* copyStatus(const BookCopy* c) {
+    return holderKey(c->holder);
 }
 
-void writeAuthorsToFile(Author* head) {
-    FILE* file = fopen("Yazarlar.csv", "w");
-    while (head) {
-        fprintf(file, "%d,%s,%s\n", head->id, head->firstName, head->lastName);
-        head = head->next;
+// --- Per-book availability bitmap ---
+// Kept in step with the copy statuses so borrowing, counting and listing
+// free copies never look at the holders.
+#define SHELF_WORDS(n) (((n) + 63) / 64)
+
+void setOnShelf(Book* b, int slot, int onShelf) {
+    unsigned long long bit = 1ULL << (slot % 64);
+    unsigned long long* word = &b->onShelf[slot / 64];
+    if (onShelf && !(*word & bit)) {
+        *word |= bit;
+        b->onShelfCount++;
+    } else if (!onShelf && (*word & bit)) {
+        *word &= ~bit;
+        b->onShelfCount--;
     }
-    fclose(file);
 }
 
-void readBookAuthorCSV(BookAuthorManager* manager) {
-    FILE* f = fopen("KitapYazar.csv", "r");
-    if (!f) return;
-    char line[100];
-    while (fgets(line, sizeof(line), f)) {
-        char isbn[14];
-        int id;
-        sscanf(line, "%13[^,],%d", isbn, &id);
-       addBookAuthorMapping(manager, isbn, id);
+int lowestBit(unsigned long long word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int i = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        i++;
     }
-    fclose(f);
+    return i;
+#endif
 }
 
-void updateBookAuthors(BookAuthorManager* manager, const char* isbn) {
-    int i, count = 0;
-    for (i = 0; i < manager->count; i++) {
-        if (strcmp(manager->list[i].isbn, isbn) == 0) {
-            manager->list[i].authorID = -1;
-            count++;
-        }
+// Slot of the first free copy at or after slot from, or -1.
+int nextOnShelf(const Book* b, int from) {
+    int word = from / 64;
+    if (from >= b->copyCount || b->onShelfCount == 0) return -1;
+    unsigned long long bits = b->onShelf[word] & (~0ULL << (from % 64));
+    while (1) {
+        if (bits) return word * 64 + lowestBit(bits);
+        if (++word >= SHELF_WORDS(b->copyCount)) return -1;
+        bits = b->onShelf[word];
     }
+}
 
-    if (count == 0) {
-        printf("No existing authors found for ISBN %s.\n", isbn);
-    } else {
-        printf("%d old author(s) removed for %s.\n", count, isbn);
+// Rebuilds the availability bitmap of a book from its copies.
+void buildShelfBitmap(Book* b) {
+    int i;
+    free(b->onShelf);
+    b->onShelf = b->copyCount ? calloc(SHELF_WORDS(b->copyCount), sizeof(unsigned long long)) : NULL;
+    b->onShelfCount = 0;
+    for (i = 0; i < b->copyCount; i++) {
+        if (b->copies[i].holder == 0) setOnShelf(b, i, 1);
     }
+}
 
-    int newCount;
-    printf("How many new authors for this book? ");
-    scanf("%d", &newCount);
-int j;
-    for (j = 0; j < newCount; j++) {
-        int newID;
-        printf("Enter author ID #%d: ", j + 1);
-        scanf("%d", &newID);
-        addBookAuthorMapping(manager, isbn, newID);
+// Resolves a copy label (ISBN_N) through the ISBN prefix and copy number
+// instead of scanning every copy in the library.
+BookCopy* findCopyByLabel(const char* label, Book** owner) {
+    const char* sep = strrchr(label, '_');
+    if (!sep || sep == label || sep - label > 13) return NULL;
+
+    char isbn[14];
+    memcpy(isbn, label, sep - label);
+    isbn[sep - label] = '\0';
+    Book* b = findBook(isbn);
+    if (!b) return NULL;
+    if (owner) *owner = b;
+
+    // Only the canonical spelling matches (ISBN_1, not ISBN_01)
+    int n = atoi(sep + 1);
+    char digits[12];
+    sprintf(digits, "%d", n);
+    if (strcmp(digits, sep + 1) != 0) return NULL;
+    if (n >= 1 && n <= b->copyCount && b->copies[n - 1].number == n)
+        return &b->copies[n - 1];
+
+    // Copy out of its position (hand-edited file): scan this book only
+    int i;
+    for (i = 0; i < b->copyCount; i++) {
+        if (b->copies[i].number == n) return &b->copies[i];
     }
+    return NULL;
+}
 
-    writeBookAuthorCSV(manager);
-    printf("Authors for book %s updated.\n", isbn);
-    return;
+// --- Title trigram -> Book* list ---
+// Titles are normalized (lower case, runs of other characters become one
+// space) and cut into overlapping 3-byte grams, padded with two spaces in
+// front and one behind. Substring and typo-tolerant searches only have to
+// look at the books that share grams with the query.
+#define TITLE_MAX_TRIGRAMS 104
+
+typedef struct {
+    unsigned int trigram; // 0 = empty slot
+    Book** books;         // in insertion order
+    int count;
+    int capacity;
+} TrigramPostings;
+
+typedef struct {
+    TrigramPostings* slots;
+    size_t capacity;      // power of two
+    size_t used;
+} TrigramIndex;
+
+static TrigramIndex titleIndex;
+
+// Writes the normalized form of title to out (at least strlen(title) + 1).
+void normalizeTitle(const char* title, char* out) {
+    int n = 0;
+    for (; *title; title++) {
+        unsigned char ch = (unsigned char)*title;
+        if ((ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch >= 0x80) out[n++] = ch;
+        else if (ch >= 'A' && ch <= 'Z') out[n++] = ch - 'A' + 'a';
+        else if (n > 0 && out[n - 1] != ' ') out[n++] = ' ';
+    }
+    if (n > 0 && out[n - 1] == ' ') n--;
+    out[n] = '\0';
 }
- 
-  
-void op_addStudent(Student** list, LoanRecord** loanList, Book* bookList) {
-    char id[9], first[50], last[50];
-    printf("ID: "); scanf("%s", id);
-    if (studentExists(*list, id)) { printf("Exists.\n"); return; }
-    printf("First name: "); scanf("%s", first);
-    printf("Last name: "); scanf("%s", last);
-    *list = addStudent(*list, id, first, last);
-    writeStudentsToFile(*list);
+
+int compareTrigrams(const void* a, const void* b) {
+    unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+    return x < y ? -1 : x > y;
 }
 
+// Distinct trigrams of a normalized string, sorted. With padded = 0 only
+// the grams inside the string are produced (what a substring must contain).
+int titleTrigrams(const char* normalized, int padded, unsigned int* out) {
+    char text[TITLE_MAX_TRIGRAMS];
+    int length = 0, count = 0, i;
+    if (padded) {
+        text[length++] = ' ';
+        text[length++] = ' ';
+    }
+    for (; *normalized && length < TITLE_MAX_TRIGRAMS - 1; normalized++) text[length++] = *normalized;
+    if (padded) text[length++] = ' ';
 
-void op_deleteStudent(Student** list, LoanRecord** loanList, Book* bookList) {
-    char id[9];
-    printf("Enter ID to delete: ");
-    scanf("%s", id);
-    if (deleteStudent(list, id)) {
-        writeStudentsToFile(*list);
-        printf("Deleted.\n");
-    } else {
-        printf("Not found.\n");
+    for (i = 0; i + 2 < length; i++) {
+        out[count++] = (unsigned char)text[i] << 16 | (unsigned char)text[i + 1] << 8 | (unsigned char)text[i + 2];
+    }
+    qsort(out, count, sizeof(unsigned int), compareTrigrams);
+    int unique = 0;
+    for (i = 0; i < count; i++) {
+        if (unique == 0 || out[unique - 1] != out[i]) out[unique++] = out[i];
     }
+    return unique;
 }
 
-void op_updateStudent(Student** list, LoanRecord** loanList, Book* bookList) {
-    char id[9], first[50], last[50];
-    printf("Enter ID to update: ");
-    scanf("%s", id);
-    printf("New First Name: ");
-    scanf("%s", first);
-    printf("New Last Name: ");
-    scanf("%s", last);
-    if (updateStudent(*list, id, first, last)) {
-        writeStudentsToFile(*list);
-        printf("Updated.\n");
-    } else {
-        printf("Not found.\n");
+TrigramPostings* findPostings(const TrigramIndex* index, unsigned int trigram) {
+    if (index->capacity == 0) return NULL;
+    size_t mask = index->capacity - 1;
+    size_t i = (trigram * 2654435761u) & mask;
+    while (index->slots[i].trigram != 0) {
+        if (index->slots[i].trigram == trigram) return &index->slots[i];
+        i = (i + 1) & mask;
     }
+    return NULL;
 }
 
-void op_viewStudent(Student** list, LoanRecord** loanList, Book* bookList) {
-    char id[9];
-    printf("Enter student ID: ");
-    scanf("%s", id);
-    showStudentInfo(*list, *loanList, id);
+TrigramPostings* addPostings(TrigramIndex* index, unsigned int trigram) {
+    if ((index->used + 1) * 4 > index->capacity * 3) {
+        size_t oldCapacity = index->capacity;
+        TrigramPostings* oldSlots = index->slots;
+        index->capacity = oldCapacity ? oldCapacity * 2 : 4096;
+        index->slots = calloc(index->capacity, sizeof(TrigramPostings));
+        size_t i;
+        for (i = 0; i < oldCapacity; i++) {
+            if (oldSlots[i].trigram == 0) continue;
+            size_t j = (oldSlots[i].trigram * 2654435761u) & (index->capacity - 1);
+            while (index->slots[j].trigram != 0) j = (j + 1) & (index->capacity - 1);
+            index->slots[j] = oldSlots[i];
+        }
+        free(oldSlots);
+    }
+    size_t mask = index->capacity - 1;
+    size_t i = (trigram * 2654435761u) & mask;
+    while (index->slots[i].trigram != 0) {
+        if (index->slots[i].trigram == trigram) return &index->slots[i];
+        i = (i + 1) & mask;
+    }
+    index->slots[i].trigram = trigram;
+    index->used++;
+    return &index->slots[i];
 }
 
-
-
-void op_listUnreturned(Student** list, LoanRecord** loanList, Book* bookList) {
-    listStudentsWithUnreturnedBooks(*list, *loanList);
+void titleIndexAdd(Book* b) {
+    char normalized[sizeof(b->title)];
+    unsigned int grams[TITLE_MAX_TRIGRAMS];
+    normalizeTitle(b->title, normalized);
+    int count = titleTrigrams(normalized, 1, grams);
+    int i;
+    for (i = 0; i < count; i++) {
+        TrigramPostings* p = addPostings(&titleIndex, grams[i]);
+        if (p->count == p->capacity) {
+            p->capacity = p->capacity ? p->capacity * 2 : 4;
+            p->books = realloc(p->books, p->capacity * sizeof(Book*));
+        }
+        p->books[p->count++] = b;
+    }
 }
 
+// Must be called with the title the book was indexed under.
+void titleIndexRemove(Book* b) {
+    char normalized[sizeof(b->title)];
+    unsigned int grams[TITLE_MAX_TRIGRAMS];
+    normalizeTitle(b->title, normalized);
+    int count = titleTrigrams(normalized, 1, grams);
+    int i, j;
+    for (i = 0; i < count; i++) {
+        TrigramPostings* p = findPostings(&titleIndex, grams[i]);
+        if (!p) continue;
+        for (j = 0; j < p->count; j++) {
+            if (p->books[j] == b) {
+                memmove(&p->books[j], &p->books[j + 1], (p->count - j - 1) * sizeof(Book*));
+                p->count--;
+                break;
+            }
+        }
+    }
+}
 
-void op_listPenalized(Student** list, LoanRecord** loanList, Book* bookList) {
-    listPenalizedStudents(*list, *loanList);
+void writeStudentsToFile(Student* head);
+void writeStudentRows(Student* head, const int* points);
+int* studentPoints(Student* head);
+void writeBooksToFile(Book* head);
+void markCopyDirty(Book* b, BookCopy* c);
+void unmarkBookDirty(Book* b);
+typedef struct StatusPatch StatusPatch;
+int copyStatusesPatchable(void);
+int takeCopyStatuses(StatusPatch** patches);
+void requeueCopyStatuses(const StatusPatch* patches, int count);
+int saveCopyStatuses(const StatusPatch* patches, int count);
+int writeLoansToFile(LoanRecord* head);
+int appendLoansToFile(LoanRecord* first, const LoanRecord* last);
+static LoanRecord* loanTail;
+static LoanRecord* journalTail; // last record already in LoanRecords.csv
+
+// Batch mode sets deferWrites: transactions then only mark what changed and
+// flushLibrary persists everything in one go.
+static int deferWrites;
+static int studentsChanged;
+static int booksChanged;
+static int mappingsChanged;
+
+// =================== Durability ===================
+
+// Full rewrites go to "<file>.tmp", which is fsynced and then renamed over
+// the file: a crash leaves the old version or the new one, never a mix.
+// The name is sized from the path (export paths come from the user), so it
+// is never cut short onto some other file's name.
+char* replacementName(const char* path) {
+    char* tmp = malloc(strlen(path) + 5);
+    if (tmp) sprintf(tmp, "%s.tmp", path);
+    return tmp;
 }
 
-void op_listAllStudents(Student** list, LoanRecord** loanList, Book* bookList) {
-    listAllStudents(*list);
+FILE* openReplacement(const char* path, const char* mode) {
+    char* tmp = replacementName(path);
+    if (!tmp) return NULL;
+    FILE* f = fopen(tmp, mode);
+    free(tmp);
+    return f;
 }
 
-void op_borrowBook(Student** studentList, LoanRecord** loanList, Book* bookList) {
-    char studentID[9], isbn[14], date[11];
-    printf("Enter Student ID: ");
-    scanf("%s", studentID);
-    printf("Enter Book ISBN: ");
-    scanf("%s", isbn);
-    printf("Enter Date (DD-MM-YYYY): ");
-    scanf("%s", date);
+int syncFile(FILE* f) {
+    if (fflush(f) != 0) return 0;
+#ifndef _WIN32
+    return fsync(fileno(f)) == 0;
+#else
+    return 1;
+#endif
+}
 
-    if (borrowBook(*studentList, bookList, loanList, studentID, isbn, date)) {
-        printf("Book borrowed successfully.\n");
+void syncPath(const char* path) {
+#ifndef _WIN32
+    int fd = open(path, O_RDWR);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
     }
+#endif
 }
 
-void op_returnBook(Student** studentList, LoanRecord** loanList, Book* bookList) {
-    char studentID[9], label[30], date[11];
-    printf("Enter Student ID: ");
-    scanf("%s", studentID);
-    printf("Enter Book Copy Label (e.g., ISBN_1): ");
-    scanf("%s", label);
-    printf("Enter Return Date (DD-MM-YYYY): ");
-    scanf("%s", date);
-
-    if (returnBook(*studentList, bookList, loanList, studentID, label, date)) {
-        printf("Book returned successfully.\n");
+// Closes a file from openReplacement and moves it into place. On failure
+// the old file is left as it was.
+int commitReplacement(FILE* f, const char* path) {
+    char* tmp = replacementName(path);
+    int ok = tmp && !ferror(f) && syncFile(f);
+    if (fclose(f) != 0) ok = 0;
+#ifdef _WIN32
+    if (ok) remove(path); // rename() doesn't replace on Windows
+#endif
+    if (ok) ok = rename(tmp, path) == 0;
+    if (!ok) {
+        if (tmp) remove(tmp);
+        free(tmp);
+        return 0;
     }
+    free(tmp);
+    syncPath("."); // the rename itself
+    return 1;
 }
 
+// How borrows and returns reach the disk. LoanRecords.csv is the commit
+// record: a transaction is durable once its journal line is fsynced. Copy
+// statuses go to Kitaplar.csv only after that, and loading rebuilds them
+// from the journal (trackOpenLoan), so they need no fsync of their own.
+// Transactions only change memory under the commit lock; the writes and
+// the fsync happen after it is released, under the write lock, so other
+// borrows and returns carry on meanwhile (see writePending).
+//  - sync:  each commit is written and fsynced before it is reported.
+//  - group: the same guarantee, but a commit that finds its record already
+//           written by a write still in progress is done: the commits
+//           queued behind one write share the next one.
+//  - async: daemon only. Commits are reported at once and written and
+//           fsynced when asyncFlushInterval seconds have passed since the
+//           last flush (on the next commit or from the daemon's flusher
+//           thread, whichever comes first). A crash loses at most that
+//           window. Interactive and batch runs have no flusher thread, so
+//           main refuses the mode there.
+// Batch mode keeps its own rule: everything is written and fsynced every
+// --flush-every commands.
+typedef enum { DURABILITY_SYNC, DURABILITY_GROUP, DURABILITY_ASYNC } Durability;
+
+static Durability durability = DURABILITY_SYNC;
+static double asyncFlushInterval = 1.0; // seconds
+static long commitsMade;    // under the commit lock
+static long commitsDurable; // under the write lock (and the commit lock to change)
+static double lastFlush;    // under the commit lock
+
+double wallClock(void);
+
+int setDurability(const char* name) {
+    if (strcmp(name, "sync") == 0) durability = DURABILITY_SYNC;
+    else if (strcmp(name, "group") == 0) durability = DURABILITY_GROUP;
+    else if (strcmp(name, "async") == 0) durability = DURABILITY_ASYNC;
+    else return 0;
+    return 1;
+}
 
-void op_addBook(Book**, LoanRecord**, Author*, BookAuthorManager*);
-void op_deleteBook(Book**, LoanRecord**, Author*, BookAuthorManager*);
-void op_updateBook(Book**, LoanRecord**, Author*, BookAuthorManager*);
-void op_viewBookByTitle(Book**, LoanRecord**, Author*, BookAuthorManager*);
-void op_listBooksOnShelf(Book**, LoanRecord**, Author*, BookAuthorManager*);
-void op_listAllBooks(Book**, LoanRecord**, Author*, BookAuthorManager*);
-void op_listOverdueBooks(Book**, LoanRecord**, Author*, BookAuthorManager*);
-void op_addBookAuthorMapping(Book**, LoanRecord**, Author*, BookAuthorManager*);
-void op_updateBookAuthors(Book**, LoanRecord**, Author*, BookAuthorManager*);
+// Commit lock held: the rest of the journal, then all of Kitaplar.csv.
+// Used for structural changes and whenever statuses can't be patched in
+// place; a whole-file rewrite reads every copy, so it keeps the lock.
+int writeJournalAndBooks(Book* books, LoanRecord** loans) {
+    if (!appendLoansToFile(journalTail ? journalTail->next : *loans, loanTail)) return 0;
+    syncPath("LoanRecords.csv");
+    writeBooksToFile(books);
+    return 1;
+}
 
+// Interactive book edits rewrite Kitaplar.csv straight away. The file
+// carries every copy status, so the journal has to catch up first.
+void writeBooksAfterJournal(Book* books, LoanRecord** loans) {
+    lockWrites();
+    lockCommit();
+    if (!writeJournalAndBooks(books, loans)) printf("Kitaplar.csv not rewritten: the loan journal couldn't be written first.\n");
+    unlockCommit();
+    unlockWrites();
+}
 
-//table for student
+// Write lock held. Takes what the commits so far left pending under the
+// commit lock (the new journal records, the changed copy statuses and, if
+// a penalty was applied, the students' points) and writes it after
+// releasing the lock: the journal first, then what depends on it. Returns
+// 0 if the journal append failed; everything taken is then queued again
+// for the next call.
+int writePending(Student* students, Book* books, LoanRecord** loans, int rewriteBooks) {
+    lockCommit();
+    long seq = commitsMade;
+    if (rewriteBooks || !copyStatusesPatchable()) {
+        int ok = writeJournalAndBooks(books, loans);
+        if (ok && studentsChanged) {
+            writeStudentsToFile(students);
+            studentsChanged = 0;
+        }
+        if (ok) {
+            commitsDurable = seq;
+            lastFlush = wallClock();
+        }
+        unlockCommit();
+        return ok;
+    }
+    LoanRecord* first = journalTail ? journalTail->next : *loans;
+    LoanRecord* last = loanTail;
+    StatusPatch* patches = NULL;
+    int patchCount = takeCopyStatuses(&patches);
+    int* points = studentsChanged ? studentPoints(students) : NULL;
+    studentsChanged = 0;
+    unlockCommit();
+
+    int ok = appendLoansToFile(first, last);
+    if (ok) {
+        syncPath("LoanRecords.csv");
+        if (!saveCopyStatuses(patches, patchCount)) {
+            lockCommit();
+            requeueCopyStatuses(patches, patchCount);
+            ok = writeJournalAndBooks(books, loans);
+            unlockCommit();
+        }
+    } else {
+        lockCommit();
+        requeueCopyStatuses(patches, patchCount);
+        unlockCommit();
+    }
+    if (points && ok) writeStudentRows(students, points);
+    else if (points) {
+        lockCommit();
+        studentsChanged = 1;
+        unlockCommit();
+    }
+    free(points);
+    free(patches);
+
+    if (ok) {
+        lockCommit();
+        commitsDurable = seq;
+        lastFlush = wallClock();
+        unlockCommit();
+    }
+    return ok;
+}
 
-StudentOperation studentOps[] = {
-    {1, "Add Student", op_addStudent},
-    {2, "Delete Student", op_deleteStudent},
-    {3, "Update Student", op_updateStudent},
-    {4, "View Student Info", op_viewStudent},
-    {5, "List Students with Unreturned Books", op_listUnreturned},
-    {6, "List Penalized Students", op_listPenalized},
-    {7, "List All Students", op_listAllStudents},
-    {8, "Borrow Book", op_borrowBook},
-    {9, "Return Book", op_returnBook},
-};
+// Called with the commit lock held once a transaction has changed memory.
+// Returns its sequence number for awaitDurable, or 0 if nothing needs to
+// be written yet (async mode within the flush interval).
+long commitTransaction(void) {
+    long seq = ++commitsMade;
+    if (durability == DURABILITY_ASYNC && wallClock() - lastFlush < asyncFlushInterval) return 0;
+    return seq;
+}
 
-// table for authors 
+// Called after releasing the commit lock; returns once commit seq is as
+// durable as the mode promises.
+void awaitDurable(long seq, Student* students, Book* books, LoanRecord** loans) {
+    if (seq == 0) return;
+    lockWrites();
+    if (durability == DURABILITY_SYNC || commitsDurable < seq) writePending(students, books, loans, 0);
+    unlockWrites();
+}
 
-AuthorOperation authorOps[] = {
-    {1, "Add Author", op_addAuthor},
-    {2, "Delete Author", op_deleteAuthor},
-    {3, "Update Author", op_updateAuthor},
-    {4, "View Author Info", op_viewAuthor},
-    {5, "List All Authors", op_listAllAuthors}
+// =================== Metrics ===================
+// Call counts, latencies, bytes written and records read or scanned for the
+// transactions, the file readers/writers and the reports. Shown by the
+// Statistics menu entry and the `stats` command, and written to STATS_FILE
+// on exit and on SIGINT/SIGTERM, so runs can be compared over time.
+//
+// Latencies go into log-linear buckets, HDR style, 384 counters per
+// operation: buckets 0-7 count 0-7 ns exactly, then each power of two
+// [2^e, 2^(e+1)) ns for e = 3..49 gets 8 buckets, so every value is known
+// to within 12.5%. The top bucket is [15 * 2^46, 2^50) ns and ends at
+// about 13.0 days (2^49 ns, the start of the last power of two, is about
+// 6.5 days); anything longer is counted in it.
+
+#define STATS_FILE "LibraryStats.txt"
+#define METRIC_SUB_BUCKETS 8
+#define METRIC_BUCKETS (48 * METRIC_SUB_BUCKETS)
+
+typedef enum {
+    METRIC_BORROW,
+    METRIC_RETURN,
+    METRIC_WRITE_STUDENTS,
+    METRIC_WRITE_BOOKS,
+    METRIC_SAVE_STATUSES,
+    METRIC_WRITE_LOANS,
+    METRIC_APPEND_LOANS,
+    METRIC_WRITE_AUTHORS,
+    METRIC_WRITE_MAPPINGS,
+    METRIC_WRITE_SNAPSHOT,
+    METRIC_READ_STUDENTS,
+    METRIC_READ_BOOKS,
+    METRIC_READ_LOANS,
+    METRIC_READ_AUTHORS,
+    METRIC_READ_MAPPINGS,
+    METRIC_LOAD_SNAPSHOT,
+    METRIC_STUDENT_INFO,
+    METRIC_BOOK_INFO,
+    METRIC_SEARCH,
+    METRIC_SHELF,
+    METRIC_ALL_STUDENTS,
+    METRIC_ALL_BOOKS,
+    METRIC_ALL_AUTHORS,
+    METRIC_UNRETURNED,
+    METRIC_PENALIZED,
+    METRIC_OVERDUE,
+    METRIC_ARCHIVED,
+    METRIC_EXPORT,
+    METRIC_IMPORT,
+    METRIC_COUNT
+} Metric;
+
+static const char* metricNames[METRIC_COUNT] = {
+    "borrowBook", "returnBook",
+    "writeStudentsToFile", "writeBooksToFile", "saveCopyStatuses", "writeLoansToFile",
+    "appendLoansToFile", "writeAuthorsToFile", "writeBookAuthorCSV", "writeSnapshot",
+    "readStudentsFromFile", "readBooksFromFile", "readLoansFromFile", "readAuthorsFromFile",
+    "readBookAuthorCSV", "loadSnapshot",
+    "showStudentInfo", "showBookInfoByTitle", "searchBooks", "listBooksOnShelf",
+    "listAllStudents", "listAllBooks", "listAllAuthors", "listStudentsWithUnreturnedBooks",
+    "listPenalizedStudents", "listOverdueBooks", "showArchivedLoans", "exportReport",
+    "importFile",
 };
 
-//table for book operations
-BookOperation bookOps[] = {
-    {1, "Add Book", op_addBook},
-    {2, "Delete Book", op_deleteBook},
-    {3, "Update Book Title", op_updateBook},
-    {4, "View Book by Title", op_viewBookByTitle},
-    {5, "List Books on Shelf", op_listBooksOnShelf},
-    {6, "List Overdue Books", op_listOverdueBooks},
-    {7, "List All Books", op_listAllBooks},
-    {8, "Add Book-Author Mapping", op_addBookAuthorMapping},
-    {9, "Update Book Authors", op_updateBookAuthors},
-};
+typedef struct {
+    long long calls;
+    long long totalNs;
+    long long maxNs;
+    long long bytes;    // written to files
+    long long records;  // read, written or scanned
+    long long buckets[METRIC_BUCKETS];
+} MetricStats;
+
+static MetricStats metrics[METRIC_COUNT];
+#ifndef _WIN32
+static pthread_mutex_t metricsMutex = PTHREAD_MUTEX_INITIALIZER; // daemon clients record concurrently
+#endif
+
+int latencyBucket(long long ns) {
+    if (ns < METRIC_SUB_BUCKETS) return ns < 0 ? 0 : (int)ns;
+    int exponent;
+#if defined(__GNUC__)
+    exponent = 63 - __builtin_clzll((unsigned long long)ns);
+#else
+    exponent = 0;
+    while ((ns >> exponent) > 1) exponent++;
+#endif
+    int bucket = (exponent - 2) * METRIC_SUB_BUCKETS + (int)((ns >> (exponent - 3)) & (METRIC_SUB_BUCKETS - 1));
+    return bucket < METRIC_BUCKETS ? bucket : METRIC_BUCKETS - 1;
+}
 
+// Smallest latency that falls into a bucket.
+long long bucketStart(int bucket) {
+    if (bucket < METRIC_SUB_BUCKETS) return bucket;
+    int exponent = bucket / METRIC_SUB_BUCKETS + 2;
+    return (long long)(METRIC_SUB_BUCKETS + bucket % METRIC_SUB_BUCKETS) << (exponent - 3);
+}
 
-// function to show book authors
-void showAuthorsForBook(const char* isbn, Author* authorList, BookAuthorManager* manager) {
-    printf("  Authors: ");
-    int found = 0;
-    int i;
-	for (i = 0; i < manager->count; i++) {
-        if (strcmp(manager->list[i].isbn, isbn) == 0 && manager->list[i].authorID != -1) {
-            Author* a = authorList;
-            while (a) {
-                if (a->id == manager->list[i].authorID) {
-                    printf("%s %s  ", a->firstName, a->lastName);
-                    found = 1;
-                    break;
-                }
-                a = a->next;
-            }
-        }
-    }
-    if (!found) printf("None");
-    printf("\n");
+// Records one call that began at start (a wallClock() reading).
+void recordMetric(Metric metric, double start, long long bytes, long long records) {
+    long long ns = (long long)((wallClock() - start) * 1e9);
+#ifndef _WIN32
+    pthread_mutex_lock(&metricsMutex);
+#endif
+    MetricStats* m = &metrics[metric];
+    m->calls++;
+    m->totalNs += ns;
+    if (ns > m->maxNs) m->maxNs = ns;
+    m->bytes += bytes;
+    m->records += records;
+    m->buckets[latencyBucket(ns)]++;
+#ifndef _WIN32
+    pthread_mutex_unlock(&metricsMutex);
+#endif
 }
-   
-void markAuthorDeletedInMappings(BookAuthorManager* manager, int deletedAuthorID) {
-    int changed = 0;
+
+// The latency below which a fraction p of the calls fall (upper edge of the
+// bucket, never above the maximum seen).
+long long metricPercentile(const MetricStats* m, double p) {
+    long long wanted = (long long)(p * m->calls + 0.999999), seen = 0;
     int i;
-	for (i = 0; i < manager->count; i++) {
-        if (manager->list[i].authorID == deletedAuthorID) {
-            manager->list[i].authorID = -1;
-            changed++;
+    for (i = 0; i < METRIC_BUCKETS; i++) {
+        seen += m->buckets[i];
+        if (seen >= wanted && seen > 0) {
+            long long upper = i + 1 < METRIC_BUCKETS ? bucketStart(i + 1) - 1 : m->maxNs;
+            return upper < m->maxNs ? upper : m->maxNs;
         }
     }
-    if (changed > 0) {
-        writeBookAuthorCSV(manager);
-        printf("%d mappings updated to -1 for deleted author ID %d.\n", changed, deletedAuthorID);
-    } else {
-        printf("No mappings found for author ID %d.\n", deletedAuthorID);
-    }
+    return m->maxNs;
 }
-   
-
-Author* deleteAuthor(Author* head, int id, BookAuthorManager* manager) {
-    Author* current = head;
-    Author* prev = NULL;
 
-    while (current) {
-        if (current->id == id) {
-            if (prev) prev->next = current->next;
-            else head = current->next;
+// Writes the table of every operation called so far; with histograms, also
+// the non-empty buckets as "from_ns:count".
+void printStatistics(FILE* out, int histograms) {
+    MetricStats* copy = malloc(sizeof(metrics));
+    if (!copy) return;
+#ifndef _WIN32
+    pthread_mutex_lock(&metricsMutex);
+#endif
+    memcpy(copy, metrics, sizeof(metrics));
+#ifndef _WIN32
+    pthread_mutex_unlock(&metricsMutex);
+#endif
+
+    int i, b, any = 0;
+    fprintf(out, "%-32s %9s %11s %10s %10s %10s %10s %12s %12s\n", "operation", "calls", "total(ms)",
+            "p50(us)", "p90(us)", "p99(us)", "max(us)", "bytes", "records");
+    for (i = 0; i < METRIC_COUNT; i++) {
+        MetricStats* m = &copy[i];
+        if (m->calls == 0) continue;
+        any = 1;
+        fprintf(out, "%-32s %9lld %11.1f %10.1f %10.1f %10.1f %10.1f %12lld %12lld\n", metricNames[i], m->calls,
+                m->totalNs / 1e6, metricPercentile(m, 0.50) / 1e3, metricPercentile(m, 0.90) / 1e3,
+                metricPercentile(m, 0.99) / 1e3, m->maxNs / 1e3, m->bytes, m->records);
+    }
+    if (!any) fprintf(out, "No operations recorded yet.\n");
 
-            free(current);
-            markAuthorDeletedInMappings(manager, id);  // <-- Fixed
-            writeAuthorsToFile(head);
-            printf("Author ID %d deleted.\n", id);
-            return head;
+    for (i = 0; histograms && i < METRIC_COUNT; i++) {
+        if (copy[i].calls == 0) continue;
+        fprintf(out, "\n%s latency histogram (from_ns:count)\n", metricNames[i]);
+        for (b = 0; b < METRIC_BUCKETS; b++) {
+            if (copy[i].buckets[b]) fprintf(out, " %lld:%lld", bucketStart(b), copy[i].buckets[b]);
         }
-        prev = current;
-        current = current->next;
+        fprintf(out, "\n");
     }
+    free(copy);
+}
 
-    printf("Author ID %d not found.\n", id);
-    return head;
+void writeStatistics(void) {
+    FILE* f = openReplacement(STATS_FILE, "w");
+    if (!f) return;
+    time_t now = time(NULL);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
+    fprintf(f, "Library statistics, written %s\n\n", stamp);
+    printStatistics(f, 1);
+    commitReplacement(f, STATS_FILE);
 }
 
+#ifndef _WIN32
+void flushLibrary(Library* lib);
+static Library* stoppingLibrary;
+
+// Interactive and batch runs: on SIGINT/SIGTERM, wait for the command in
+// progress, write what it and the commands before it left pending (batch
+// mode defers all writes), write the statistics and end the process the
+// way the signal would have. Both modes hold the library lock while they
+// change anything; the interactive menus release it while they wait for
+// input. Installed only once the library is loaded.
+void* flushOnSignal(void* arg) {
+    sigset_t* signals = arg;
+    int sig;
+    sigwait(signals, &sig);
+    lockLibrary(1);
+    lockCommit();
+    int pending = deferWrites || commitsDurable < commitsMade;
+    unlockCommit();
+    if (pending) flushLibrary(stoppingLibrary);
+    writeStatistics();
+    _exit(128 + sig);
+}
 
-Author* readAuthorsFromFile() {
-    FILE* file = fopen("Yazarlar.csv", "r");
-    if (!file) return NULL;
+// Also turns locking on, so the signal thread can wait for a command to
+// finish before it writes anything.
+void catchStopSignals(Library* lib) {
+    static sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    stoppingLibrary = lib;
+    initLocking();
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, flushOnSignal, &signals) == 0) pthread_detach(thread);
+    else pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+}
+#endif
 
-    char line[200];
-    Author* head = NULL;
-    Author* tail = NULL;
+Student* addStudent(Student* head, char* id, char* first, char* last);
+int deleteStudent(Student** head, const char* id);
+int updateStudent(Student* head, const char* id, const char* newFirst, const char* newLast);
 
-    while (fgets(line, sizeof(line), file)) {
-        Author* a = malloc(sizeof(Author));
-        sscanf(line, "%d,%49[^,],%49[^\n]", &a->id, a->firstName, a->lastName);
-        a->next = NULL;
+int studentExists(Student* head, const char* id) {
+    (void)head; // kept for the list-style callers; the ID index answers this
+    return findStudent(id) != NULL;  // ID already exists
+}
+LoanRecord* addLoanRecord(LoanRecord* head, const char* studentID, const char* label, int type, int day);
+
+// time function prototypes
+#define INVALID_DAY INT_MIN
+int parseDate(const char* date);
+void formatDate(int day, char* out);
+int today(void);
+#define LOAN_PERIOD 15 // days a copy may be kept without penalty
+
+// Every loan that has not been returned yet, as a min-heap on the loan day:
+// the loans due first sit on top, so finding what is overdue only visits
+// overdue loans.
+static LoanRecord** openLoans;
+static int openLoanCount, openLoanCapacity;
+static StringIndex openLoanIndex;    // copy label -> its type-0 record while borrowed
+void setOutstanding(LoanRecord* record, int outstanding);
+
+static int borrowBookLocked(Student* studentList, Book* bookList, LoanRecord** loanList, const char* studentID, const char* isbn, const char* date) {
+    int day = parseDate(date);
+    if (day == INVALID_DAY) {
+        fprintf(OUT, "Invalid date, expected DD-MM-YYYY.\n");
+        return 0;
+    }
 
-        if (!head) head = tail = a;
-        else {
-            tail->next = a;
-            tail = a;
-        }
+    // 1. Check student exists
+    Student* s = findStudent(studentID);
+    if (!s) {
+        fprintf(OUT, "Student not found.\n");
+        return 0;
     }
 
-    fclose(file);
-    return head;
-}
-// View Author Information
-void viewAuthorInfo(const char* firstName, Author* authorList, Book* bookList, BookAuthorManager* manager) {
-    Author* author = authorList;
-    int found = 0;
-    while (author) {
-        if (strcmp(author->firstName, firstName) == 0) {
-            printf("Author ID: %d\nName: %s %s\n", author->id, author->firstName, author->lastName);
-            printf("Books by this author:\n");
-            int i;
-            for (i = 0; i < manager->count; i++) {
-                if (manager->list[i].authorID == author->id && manager->list[i].authorID != -1) {
-                    Book* book = bookList;
-                    while (book) {
-                        if (strcmp(book->isbn, manager->list[i].isbn) == 0) {
-                            printf("- %s (ISBN: %s)\n", book->title, book->isbn);
-                            break;
-                        }
-                        book = book->next;
-                    }
-                }
-            }
-            found = 1;
-            break;
-        }
-        author = author->next;
+    if (s->points <= 0) {
+        fprintf(OUT, "Student has insufficient points.\n");
+        return 0;
     }
-    if (!found) {
-        printf("Author not found.\n");
+
+    // 2. Find a free copy of the book
+    Book* b = findBook(isbn);
+    if (!b) {
+        fprintf(OUT, "Book not found.\n");
+        return 0;
+    }
+
+    if (b->onShelfCount == 0) {
+        fprintf(OUT, "OPERATION FAILED: All copies are currently borrowed.\n");
+        return 0;
     }
+    int slot = nextOnShelf(b, 0);
+    BookCopy* copy = &b->copies[slot];
+    char label[30];
+    copyLabel(b, copy, label);
+
+    lockCommit();
+    // 3. Mark as borrowed
+    copy->holder = s->holder;
+    setOnShelf(b, slot, 0);
+    markCopyDirty(b, copy);
+
+    // 4. Record transaction
+  *loanList = addLoanRecord(*loanList, studentID, label, 0, day);
+
+    long seq = deferWrites ? 0 : commitTransaction();
+    unlockCommit();
+    awaitDurable(seq, studentList, bookList, loanList);
+
+    fprintf(OUT, "Book %s successfully borrowed by %s.\n", label, studentID);
+    return 1;
 }
 
+static int returnBookLocked(Student* studentList, Book* bookList, LoanRecord** loanList, const char* studentID, const char* label, const char* returnDate) {
+    int returnDay = parseDate(returnDate);
+    if (returnDay == INVALID_DAY) {
+        fprintf(OUT, "Invalid date, expected DD-MM-YYYY.\n");
+        return 0;
+    }
 
-// Update Author (basic implementation)
-Author* updateAuthor(Author* head, int id) {
-    Author* current = head;
-    while (current) {
-        if (current->id == id) {
-            char first[50], last[50];
-            printf("Enter new first name: ");
-            scanf("%s", first);
-            printf("Enter new last name: ");
-            scanf("%s", last);
-            strcpy(current->firstName, first);
-            strcpy(current->lastName, last);
-            printf("Author updated.\n");
-            return head;
+    // 1. Check student exists
+    Student* s = findStudent(studentID);
+    if (!s) {
+        fprintf(OUT, "Student not found.\n");
+        return 0;
+    }
+
+    // 2. Find the book copy
+    Book* b = NULL;
+    BookCopy* c = findCopyByLabel(label, &b);
+    if (!c) {
+        fprintf(OUT, "Book copy not found.\n");
+        return 0;
+    }
+
+    if (c->holder != s->holder) {
+        fprintf(OUT, "This book is not borrowed by this student.\n");
+        return 0;
+    }
+
+    lockCommit();
+    // 3. Find matching loan date
+    LoanRecord* match = indexFind(&openLoanIndex, label);
+    if (match && strcmp(match->studentID, studentID) != 0) match = NULL;
+
+    // 4. Calculate delay
+    if (match) {
+        int days = returnDay - match->day;
+        if (days > LOAN_PERIOD) {
+            fprintf(OUT, "Returned late. -10 penalty applied.\n");
+            s->points -= 10;
+            if (s->points < 0) s->points = 0;
+            studentsChanged = 1;
         }
-        current = current->next;
     }
-    printf("Author ID %d not found.\n", id);
-    return head;
-}
 
+    // 5. Mark book as on shelf
+    c->holder = 0;
+    setOnShelf(b, c - b->copies, 1);
+    markCopyDirty(b, c);
 
-// =================== Student Functions ===================
-Student* addStudent(Student* head, char* id, char* first, char* last) {
-    Student* newStudent = malloc(sizeof(Student));
-    strcpy(newStudent->id, id);
-    strcpy(newStudent->firstName, first);
-    strcpy(newStudent->lastName, last);
-    newStudent->points = 100;
-    newStudent->next = NULL;
-    newStudent->prev = NULL;
+    // 6. Record return
+   *loanList = addLoanRecord(*loanList, studentID, label, 1, returnDay);
 
-    if (!head) return newStudent;
+    long seq = deferWrites ? 0 : commitTransaction();
+    unlockCommit();
+    awaitDurable(seq, studentList, bookList, loanList);
 
-    Student* tail = head;
-    while (tail->next) tail = tail->next;
+    fprintf(OUT, "Book %s successfully returned.\n", label);
+    return 1;
+}
 
-    tail->next = newStudent;
-    newStudent->prev = tail;
-    return head;
+// Transactions hold the student's stripe and the book's stripe so that two
+// clients can't hand out the same copy or return the same loan twice.
+int borrowBook(Student* studentList, Book* bookList, LoanRecord** loanList, const char* studentID, const char* isbn, const char* date) {
+    double start = wallClock();
+    lockStudent(studentID);
+    lockBook(isbn);
+    int ok = borrowBookLocked(studentList, bookList, loanList, studentID, isbn, date);
+    unlockBook(isbn);
+    unlockStudent(studentID);
+    recordMetric(METRIC_BORROW, start, 0, 0);
+    return ok;
 }
 
-void writeStudentsToFile(Student* head) {
-    FILE* file = fopen("Ogrenciler.csv", "w");
-    if (!file) {
-        printf("Could not open file for writing.\n");
-        return;
+int returnBook(Student* studentList, Book* bookList, LoanRecord** loanList, const char* studentID, const char* label, const char* returnDate) {
+    double start = wallClock();
+    // Copy labels are ISBN_N; the book stripe is keyed by the ISBN part
+    char isbn[14];
+    const char* sep = strrchr(label, '_');
+    size_t len = (sep && sep - label < (ptrdiff_t)sizeof(isbn)) ? (size_t)(sep - label) : 0;
+    memcpy(isbn, label, len);
+    isbn[len] = '\0';
+
+    lockStudent(studentID);
+    lockBook(isbn);
+    int ok = returnBookLocked(studentList, bookList, loanList, studentID, label, returnDate);
+    unlockBook(isbn);
+    unlockStudent(studentID);
+    recordMetric(METRIC_RETURN, start, 0, 0);
+    return ok;
+}
+ 
+
+ 
+ // Author function prototypes
+Author* addAuthor(Author* head, char* first, char* last);
+void writeAuthorsToFile(Author* head);
+Author* deleteAuthor(Author* head, int id, BookAuthorManager* manager);
+Author* readAuthorsFromFile(void);
+void viewAuthorInfo(const char* firstName, Author* authorList, Book* bookList, BookAuthorManager* manager);
+Author* updateAuthor(Author* head, int id);
+
+// student functions  prototypes 
+void showStudentInfo(Student* head, LoanRecord* loans,  const char* id);
+void listStudentsWithUnreturnedBooks(Student* students, LoanRecord* loans);
+void listPenalizedStudents(Student* students, LoanRecord* loans);
+void listAllStudents(Student* students);
+
+
+// book function prototypes
+
+Book* addBook(Book* head, char* title, char* isbn, int quantity);
+Book* deleteBookByISBN(Book* head, const char* isbn);
+int updateBookTitle(Book* head, const char* isbn, const char* newTitle);
+int bookExists(Book* head, const char* isbn);
+void showBookInfoByTitle(Book* head, const char* title);
+void searchBooks(Book* head, const char* query);
+void listBooksOnShelf(Book* head);
+void listOverdueBooks(LoanRecord* loans);
+
+
+typedef void (*AuthorOpFunc)(Author**, BookAuthorManager*, Book*) ; 
+
+  void op_addAuthor(Author** list, BookAuthorManager* manager, Book* bookList) {
+    char first[50], last[50];
+    printf("Enter first name: ");
+    scanf("%s", first);
+    printf("Enter last name: ");
+    scanf("%s", last);
+    lockLibrary(1);
+    *list = addAuthor(*list, first, last);
+    writeAuthorsToFile(*list);
+    unlockLibrary();
+    printf("Author added.\n");
+}
+
+
+void op_deleteAuthor(Author** list, BookAuthorManager* manager,Book* bookList) {
+    int id;
+    printf("Enter author ID to delete: ");
+    scanf("%d", &id);
+    lockLibrary(1);
+    *list = deleteAuthor(*list, id, manager);
+    unlockLibrary();
+}
+
+void op_updateAuthor(Author** list, BookAuthorManager* manager,Book* bookList) {
+    int id;
+    printf("Enter author ID to update: ");
+    scanf("%d", &id);
+    updateAuthor(*list, id);
+    lockLibrary(1);
+    writeAuthorsToFile(*list);
+    unlockLibrary();
+}
+
+void op_viewAuthor(Author** list, BookAuthorManager* manager, Book* bookList) {
+    char first[50];
+    printf("Enter author's first name: ");
+    scanf("%s", first);
+    lockLibrary(0);
+    viewAuthorInfo(first, *list, bookList, manager);
+    unlockLibrary();
+}
+
+void op_listAllAuthors(Author** list, BookAuthorManager* manager,Book* bookList) {
+    double start = wallClock();
+    long long count = 0;
+    printf("\n--- ALL AUTHORS ---\n");
+    Author* a;
+    lockLibrary(0);
+    for (a = *list; a != NULL; a = a->next, count++) {
+        printf("ID: %d | Name: %s %s\n", a->id, a->firstName, a->lastName);
+    }
+    unlockLibrary();
+    recordMetric(METRIC_ALL_AUTHORS, start, 0, count);
+}
+
+
+// =================== Author Functions ===================
+Author* addAuthor(Author* head, char* first, char* last) {
+    Author* newAuthor = poolAlloc(&authorPool);
+
+    // Find the current maximum ID in the list
+    int maxID = 0;
+    Author* temp = head;
+    while (temp != NULL) {
+        if (temp->id > maxID) maxID = temp->id;
+        temp = temp->next;
+    }
+
+    newAuthor->id = maxID + 1; // Assign next ID
+    strcpy(newAuthor->firstName, first);
+    strcpy(newAuthor->lastName, last);
+    newAuthor->next = NULL;
+    indexAuthor(newAuthor);
+
+    // Insert into sorted list (keep your existing code here)
+    if (!head) return newAuthor;
+
+    Author* current = head;
+    Author* prev = NULL;
+    while (current && current->id < newAuthor->id) {
+        prev = current;
+        current = current->next;
+    }
+    if (!prev) {
+        newAuthor->next = head;
+        return newAuthor;
+    }
+    prev->next = newAuthor;
+    newAuthor->next = current;
+    return head;
+}
+
+// --- ISBN -> the book's first mapping, author ID -> the author's first ---
+static StringIndex authorsByBook;
+static IntIndex booksByAuthor;
+
+BookAuthor* firstAuthorOf(const char* isbn) {
+    return indexFind(&authorsByBook, isbn);
+}
+
+BookAuthor* firstBookOf(int authorID) {
+    return intIndexFind(&booksByAuthor, authorID);
+}
+
+void addBookAuthorMapping(BookAuthorManager* manager, const char* isbn, int authorID) {
+    BookAuthor* m = poolAlloc(&mappingPool);
+    strcpy(m->isbn, isbn);
+    m->authorID = authorID;
+
+    m->next = NULL;
+    m->prev = manager->last;
+    if (manager->last) manager->last->next = m;
+    else manager->first = m;
+    manager->last = m;
+    manager->count++;
+
+    // Appended so a book's authors and an author's books keep file order;
+    // the first mapping's prev pointer doubles as the list's tail.
+    BookAuthor* first = firstAuthorOf(isbn);
+    m->nextForBook = NULL;
+    if (!first) {
+        m->prevForBook = m;
+        indexInsert(&authorsByBook, m->isbn, m);
+    } else {
+        m->prevForBook = first->prevForBook;
+        first->prevForBook->nextForBook = m;
+        first->prevForBook = m;
+    }
+
+    first = firstBookOf(authorID);
+    m->nextForAuthor = NULL;
+    if (!first) {
+        m->prevForAuthor = m;
+        intIndexInsert(&booksByAuthor, authorID, m);
+    } else {
+        m->prevForAuthor = first->prevForAuthor;
+        first->prevForAuthor->nextForAuthor = m;
+        first->prevForAuthor = m;
+    }
+}
+
+void removeBookAuthorMapping(BookAuthorManager* manager, BookAuthor* m) {
+    if (m->prev) m->prev->next = m->next;
+    else manager->first = m->next;
+    if (m->next) m->next->prev = m->prev;
+    else manager->last = m->prev;
+    manager->count--;
+
+    BookAuthor* first = firstAuthorOf(m->isbn);
+    if (first == m) {
+        indexRemove(&authorsByBook, m->isbn, m);
+        if (m->nextForBook) {
+            m->nextForBook->prevForBook = m->prevForBook;
+            indexInsert(&authorsByBook, m->nextForBook->isbn, m->nextForBook);
+        }
+    } else {
+        m->prevForBook->nextForBook = m->nextForBook;
+        if (m->nextForBook) m->nextForBook->prevForBook = m->prevForBook;
+        else first->prevForBook = m->prevForBook;
+    }
+
+    first = firstBookOf(m->authorID);
+    if (first == m) {
+        intIndexRemove(&booksByAuthor, m->authorID, m);
+        if (m->nextForAuthor) {
+            m->nextForAuthor->prevForAuthor = m->prevForAuthor;
+            intIndexInsert(&booksByAuthor, m->authorID, m->nextForAuthor);
+        }
+    } else {
+        m->prevForAuthor->nextForAuthor = m->nextForAuthor;
+        if (m->nextForAuthor) m->nextForAuthor->prevForAuthor = m->prevForAuthor;
+        else first->prevForAuthor = m->prevForAuthor;
+    }
+
+    poolFree(&mappingPool, m);
+}
+
+void writeBookAuthorCSV(BookAuthorManager* manager) {
+    double start = wallClock();
+    FILE* f = openReplacement("KitapYazar.csv", "w");
+    if (!f) {
+        printf("Couldn't write to KitapYazar.csv\n");
+        return;
+    }
+    BookAuthor* m;
+    long long bytes = 0, count = 0;
+    for (m = manager->first; m != NULL; m = m->next, count++) {
+        bytes += fprintf(f, "%s,%d\n", m->isbn, m->authorID);
+    }
+    if (!commitReplacement(f, "KitapYazar.csv")) printf("Couldn't write to KitapYazar.csv\n");
+    recordMetric(METRIC_WRITE_MAPPINGS, start, bytes, count);
+}
+
+void writeAuthorsToFile(Author* head) {
+    double start = wallClock();
+    FILE* file = openReplacement("Yazarlar.csv", "w");
+    if (!file) {
+        printf("Couldn't write to Yazarlar.csv\n");
+        return;
+    }
+    long long bytes = 0, count = 0;
+    while (head) {
+        bytes += fprintf(file, "%d,%s,%s\n", head->id, head->firstName, head->lastName);
+        head = head->next;
+        count++;
+    }
+    if (!commitReplacement(file, "Yazarlar.csv")) printf("Couldn't write to Yazarlar.csv\n");
+    recordMetric(METRIC_WRITE_AUTHORS, start, bytes, count);
+}
+
+void readBookAuthorCSV(BookAuthorManager* manager) {
+    double start = wallClock();
+    FILE* f = fopen("KitapYazar.csv", "r");
+    if (!f) return;
+    char line[100];
+    long long count = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char isbn[14];
+        int id;
+        count++;
+        if (sscanf(line, "%13[^,],%d", isbn, &id) != 2) continue;
+        if (id == -1) continue; // removed mapping left by older versions
+        addBookAuthorMapping(manager, isbn, id);
+    }
+    fclose(f);
+    recordMetric(METRIC_READ_MAPPINGS, start, 0, count);
+}
+
+void updateBookAuthors(BookAuthorManager* manager, const char* isbn) {
+    int count = 0;
+    BookAuthor* m;
+    lockLibrary(1);
+    while ((m = firstAuthorOf(isbn)) != NULL) {
+        removeBookAuthorMapping(manager, m);
+        count++;
+    }
+    unlockLibrary();
+
+    if (count == 0) {
+        printf("No existing authors found for ISBN %s.\n", isbn);
+    } else {
+        printf("%d old author(s) removed for %s.\n", count, isbn);
+    }
+
+    int newCount;
+    printf("How many new authors for this book? ");
+    scanf("%d", &newCount);
+int j;
+    for (j = 0; j < newCount; j++) {
+        int newID;
+        printf("Enter author ID #%d: ", j + 1);
+        scanf("%d", &newID);
+        lockLibrary(1);
+        addBookAuthorMapping(manager, isbn, newID);
+        unlockLibrary();
+    }
+
+    lockLibrary(1);
+    writeBookAuthorCSV(manager);
+    unlockLibrary();
+    printf("Authors for book %s updated.\n", isbn);
+    return;
+}
+ 
+  
+void op_addStudent(Student** list, LoanRecord** loanList, Book* bookList) {
+    char id[9], first[50], last[50];
+    printf("ID: "); scanf("%s", id);
+    if (studentExists(*list, id)) { printf("Exists.\n"); return; }
+    printf("First name: "); scanf("%s", first);
+    printf("Last name: "); scanf("%s", last);
+    lockLibrary(1);
+    *list = addStudent(*list, id, first, last);
+    writeStudentsToFile(*list);
+    unlockLibrary();
+}
+
+
+void op_deleteStudent(Student** list, LoanRecord** loanList, Book* bookList) {
+    char id[9];
+    printf("Enter ID to delete: ");
+    scanf("%s", id);
+    lockLibrary(1);
+    int deleted = deleteStudent(list, id);
+    if (deleted) writeStudentsToFile(*list);
+    unlockLibrary();
+    printf(deleted ? "Deleted.\n" : "Not found.\n");
+}
+
+void op_updateStudent(Student** list, LoanRecord** loanList, Book* bookList) {
+    char id[9], first[50], last[50];
+    printf("Enter ID to update: ");
+    scanf("%s", id);
+    printf("New First Name: ");
+    scanf("%s", first);
+    printf("New Last Name: ");
+    scanf("%s", last);
+    lockLibrary(1);
+    int updated = updateStudent(*list, id, first, last);
+    if (updated) writeStudentsToFile(*list);
+    unlockLibrary();
+    printf(updated ? "Updated.\n" : "Not found.\n");
+}
+
+void op_viewStudent(Student** list, LoanRecord** loanList, Book* bookList) {
+    char id[9];
+    printf("Enter student ID: ");
+    scanf("%s", id);
+    lockLibrary(0);
+    showStudentInfo(*list, *loanList, id);
+    unlockLibrary();
+}
+
+
+
+void op_listUnreturned(Student** list, LoanRecord** loanList, Book* bookList) {
+    lockLibrary(0);
+    listStudentsWithUnreturnedBooks(*list, *loanList);
+    unlockLibrary();
+}
+
+
+void op_listPenalized(Student** list, LoanRecord** loanList, Book* bookList) {
+    lockLibrary(0);
+    listPenalizedStudents(*list, *loanList);
+    unlockLibrary();
+}
+
+void op_listAllStudents(Student** list, LoanRecord** loanList, Book* bookList) {
+    lockLibrary(0);
+    listAllStudents(*list);
+    unlockLibrary();
+}
+
+void op_borrowBook(Student** studentList, LoanRecord** loanList, Book* bookList) {
+    char studentID[9], isbn[14], date[11];
+    printf("Enter Student ID: ");
+    scanf("%s", studentID);
+    printf("Enter Book ISBN: ");
+    scanf("%s", isbn);
+    printf("Enter Date (DD-MM-YYYY): ");
+    scanf("%s", date);
+
+    lockLibrary(1);
+    int borrowed = borrowBook(*studentList, bookList, loanList, studentID, isbn, date);
+    unlockLibrary();
+    if (borrowed) printf("Book borrowed successfully.\n");
+}
+
+void op_returnBook(Student** studentList, LoanRecord** loanList, Book* bookList) {
+    char studentID[9], label[30], date[11];
+    printf("Enter Student ID: ");
+    scanf("%s", studentID);
+    printf("Enter Book Copy Label (e.g., ISBN_1): ");
+    scanf("%s", label);
+    printf("Enter Return Date (DD-MM-YYYY): ");
+    scanf("%s", date);
+
+    lockLibrary(1);
+    int returned = returnBook(*studentList, bookList, loanList, studentID, label, date);
+    unlockLibrary();
+    if (returned) printf("Book returned successfully.\n");
+}
+
+
+long compactLoanHistory(LoanRecord** loanList, int cutoffDay);
+void showArchivedLoans(const char* studentID);
+
+void op_archiveLoans(Student** studentList, LoanRecord** loanList, Book* bookList) {
+    char date[12];
+    printf("Archive loans returned before (DD-MM-YYYY): ");
+    scanf("%11s", date);
+    int cutoff = parseDate(date);
+    if (cutoff == INVALID_DAY) {
+        printf("Invalid date, expected DD-MM-YYYY.\n");
+        return;
+    }
+    lockLibrary(1);
+    long archived = compactLoanHistory(loanList, cutoff);
+    unlockLibrary();
+    if (archived < 0) printf("Couldn't write the loan archive or LoanRecords.csv; nothing was moved.\n");
+    else printf("%ld loan(s) moved to the archive.\n", archived);
+}
+
+void op_viewArchivedLoans(Student** studentList, LoanRecord** loanList, Book* bookList) {
+    char id[9];
+    printf("Enter student ID: ");
+    scanf("%8s", id);
+    showArchivedLoans(id);
+}
+
+void op_addBook(Book**, LoanRecord**, Author*, BookAuthorManager*);
+void op_deleteBook(Book**, LoanRecord**, Author*, BookAuthorManager*);
+void op_updateBook(Book**, LoanRecord**, Author*, BookAuthorManager*);
+void op_viewBookByTitle(Book**, LoanRecord**, Author*, BookAuthorManager*);
+void op_searchBooks(Book**, LoanRecord**, Author*, BookAuthorManager*);
+void op_listBooksOnShelf(Book**, LoanRecord**, Author*, BookAuthorManager*);
+void op_listAllBooks(Book**, LoanRecord**, Author*, BookAuthorManager*);
+void op_listOverdueBooks(Book**, LoanRecord**, Author*, BookAuthorManager*);
+void op_addBookAuthorMapping(Book**, LoanRecord**, Author*, BookAuthorManager*);
+void op_updateBookAuthors(Book**, LoanRecord**, Author*, BookAuthorManager*);
+
+
+//table for student
+
+StudentOperation studentOps[] = {
+    {1, "Add Student", op_addStudent},
+    {2, "Delete Student", op_deleteStudent},
+    {3, "Update Student", op_updateStudent},
+    {4, "View Student Info", op_viewStudent},
+    {5, "List Students with Unreturned Books", op_listUnreturned},
+    {6, "List Penalized Students", op_listPenalized},
+    {7, "List All Students", op_listAllStudents},
+    {8, "Borrow Book", op_borrowBook},
+    {9, "Return Book", op_returnBook},
+    {10, "Archive Old Loan History", op_archiveLoans},
+    {11, "View Archived Loans", op_viewArchivedLoans},
+};
+
+// table for authors 
+
+AuthorOperation authorOps[] = {
+    {1, "Add Author", op_addAuthor},
+    {2, "Delete Author", op_deleteAuthor},
+    {3, "Update Author", op_updateAuthor},
+    {4, "View Author Info", op_viewAuthor},
+    {5, "List All Authors", op_listAllAuthors}
+};
+
+//table for book operations
+BookOperation bookOps[] = {
+    {1, "Add Book", op_addBook},
+    {2, "Delete Book", op_deleteBook},
+    {3, "Update Book Title", op_updateBook},
+    {4, "View Book by Title", op_viewBookByTitle},
+    {5, "List Books on Shelf", op_listBooksOnShelf},
+    {6, "List Overdue Books", op_listOverdueBooks},
+    {7, "List All Books", op_listAllBooks},
+    {8, "Add Book-Author Mapping", op_addBookAuthorMapping},
+    {9, "Update Book Authors", op_updateBookAuthors},
+    {10, "Search Books by Title", op_searchBooks},
+};
+
+
+// function to show book authors
+void showAuthorsForBook(const char* isbn, Author* authorList, BookAuthorManager* manager) {
+    printf("  Authors: ");
+    int found = 0;
+    BookAuthor* m;
+    for (m = firstAuthorOf(isbn); m != NULL; m = m->nextForBook) {
+        Author* a = findAuthor(m->authorID);
+        if (a) {
+            printf("%s %s  ", a->firstName, a->lastName);
+            found = 1;
+        }
+    }
+    if (!found) printf("None");
+    printf("\n");
+}
+   
+void removeAuthorFromMappings(BookAuthorManager* manager, int deletedAuthorID) {
+    int changed = 0;
+    BookAuthor* m;
+    while ((m = firstBookOf(deletedAuthorID)) != NULL) {
+        removeBookAuthorMapping(manager, m);
+        changed++;
+    }
+    if (changed > 0) {
+        writeBookAuthorCSV(manager);
+        printf("%d mappings removed for deleted author ID %d.\n", changed, deletedAuthorID);
+    } else {
+        printf("No mappings found for author ID %d.\n", deletedAuthorID);
+    }
+}
+   
+
+Author* deleteAuthor(Author* head, int id, BookAuthorManager* manager) {
+    Author* current = head;
+    Author* prev = NULL;
+
+    while (current) {
+        if (current->id == id) {
+            if (prev) prev->next = current->next;
+            else head = current->next;
+
+            unindexAuthor(current);
+            poolFree(&authorPool, current);
+            removeAuthorFromMappings(manager, id);
+            writeAuthorsToFile(head);
+            printf("Author ID %d deleted.\n", id);
+            return head;
+        }
+        prev = current;
+        current = current->next;
+    }
+
+    printf("Author ID %d not found.\n", id);
+    return head;
+}
+
+
+Author* readAuthorsFromFile() {
+    double start = wallClock();
+    long long count = 0;
+    FILE* file = fopen("Yazarlar.csv", "r");
+    if (!file) return NULL;
+
+    char line[200];
+    Author* head = NULL;
+    Author* tail = NULL;
+
+    while (fgets(line, sizeof(line), file)) {
+        Author* a = poolAlloc(&authorPool);
+        sscanf(line, "%d,%49[^,],%49[^\n]", &a->id, a->firstName, a->lastName);
+        a->next = NULL;
+        indexAuthor(a);
+
+        if (!head) head = tail = a;
+        else {
+            tail->next = a;
+            tail = a;
+        }
+        count++;
+    }
+
+    fclose(file);
+    recordMetric(METRIC_READ_AUTHORS, start, 0, count);
+    return head;
+}
+// View Author Information
+void viewAuthorInfo(const char* firstName, Author* authorList, Book* bookList, BookAuthorManager* manager) {
+    Author* author = findAuthorByFirstName(firstName);
+    if (!author) {
+        printf("Author not found.\n");
+        return;
+    }
+    printf("Author ID: %d\nName: %s %s\n", author->id, author->firstName, author->lastName);
+    printf("Books by this author:\n");
+    BookAuthor* m;
+    for (m = firstBookOf(author->id); m != NULL; m = m->nextForAuthor) {
+        Book* book = findBook(m->isbn);
+        if (book) {
+            printf("- %s (ISBN: %s)\n", book->title, book->isbn);
+        }
+    }
+}
+
+
+// Update Author (basic implementation)
+Author* updateAuthor(Author* head, int id) {
+    Author* current = head;
+    while (current) {
+        if (current->id == id) {
+            char first[50], last[50];
+            printf("Enter new first name: ");
+            scanf("%s", first);
+            printf("Enter new last name: ");
+            scanf("%s", last);
+            lockLibrary(1);
+            unindexAuthor(current);
+            strcpy(current->firstName, first);
+            strcpy(current->lastName, last);
+            indexAuthor(current);
+            unlockLibrary();
+            printf("Author updated.\n");
+            return head;
+        }
+        current = current->next;
+    }
+    printf("Author ID %d not found.\n", id);
+    return head;
+}
+
+
+// =================== Parallel Loading ===================
+
+// The CSV readers map the file, cut it into newline-aligned chunks and
+// parse the chunks on worker threads. Each worker allocates from its own
+// pool (merged into the global one afterwards) and builds a partial
+// list; the caller links the partial lists in file order and does the
+// order-dependent work (index inserts, open-loan tracking) in one pass.
+#define LOAD_MAX_THREADS 64
+#define LOAD_MIN_CHUNK (256 * 1024) // smaller files aren't worth a thread
+
+static int loadThreads; // 0 = one per online core
+
+typedef struct LoadChunk {
+    const char* base;     // start of the file, for offsets
+    const char* cursor;   // next line to parse
+    const char* end;
+    Pool pool;            // records of this chunk
+    void* head;           // partial list, in file order
+    void* tail;
+    BookCopy* orphans;    // copy lines before the chunk's first book line (Kitaplar.csv)
+    int orphanCount;
+    char orphanIsbn[14];  // ISBN the orphans' labels share, "" if not fixed-width
+    int unterminated;     // the file's last line has no newline (LoanRecords.csv)
+    long tornAt;          // where that line starts if it was left out, else -1
+    long skipped;         // malformed lines left out (LoanRecords.csv)
+    void (*parse)(struct LoadChunk*);
+} LoadChunk;
+
+char* mapFile(const char* path, size_t* size);
+void unmapFile(char* data, size_t size);
+
+// Copies the next line of the chunk into line, like fgets, and returns its
+// offset in the file, or -1 at the end of the chunk.
+long nextLine(LoadChunk* chunk, char* line, size_t size) {
+    if (chunk->cursor >= chunk->end) return -1;
+    const char* start = chunk->cursor;
+    const char* newline = memchr(start, '\n', chunk->end - start);
+    chunk->cursor = newline ? newline + 1 : chunk->end;
+
+    size_t length = chunk->cursor - start;
+    if (length > size - 1) length = size - 1;
+    memcpy(line, start, length);
+    line[length] = '\0';
+    return start - chunk->base;
+}
+
+int loadWorkerCount(size_t size) {
+    long n = loadThreads;
+#ifndef _WIN32
+    if (n <= 0) n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n > LOAD_MAX_THREADS) n = LOAD_MAX_THREADS;
+    if (n > (long)(size / LOAD_MIN_CHUNK)) n = size / LOAD_MIN_CHUNK;
+    return n < 1 ? 1 : (int)n;
+}
+
+#ifndef _WIN32
+void* runLoadChunk(void* arg) {
+    LoadChunk* chunk = arg;
+    chunk->parse(chunk);
+    return NULL;
+}
+#endif
+
+// Hands a worker's slabs over to the global pool. Whatever is left of the
+// worker's newest slab stays unused.
+void poolAdopt(Pool* into, Pool* from) {
+    PoolSlab* slab = from->slabs;
+    while (slab) {
+        PoolSlab* next = slab->next;
+        slab->next = into->slabs;
+        into->slabs = slab;
+        slab = next;
+    }
+}
+
+// Parses path with parse on up to one thread per core. Returns the chunks
+// in file order (free() them after linking the lists) and their number in
+// *count, or NULL if the file is missing or empty.
+LoadChunk* loadChunks(const char* path, void (*parse)(LoadChunk*), Pool* pool, int* count) {
+    size_t size;
+    char* data = mapFile(path, &size);
+    if (!data) return NULL;
+
+    int n = loadWorkerCount(size);
+    LoadChunk* chunks = calloc(n, sizeof(LoadChunk));
+    if (!chunks) {
+        unmapFile(data, size);
+        return NULL;
+    }
+    const char* start = data;
+    int i;
+    for (i = 0; i < n; i++) {
+        const char* end = data + size;
+        if (i < n - 1) {
+            end = data + size / n * (i + 1);
+            if (end < start) end = start;
+            const char* newline = memchr(end, '\n', data + size - end);
+            end = newline ? newline + 1 : data + size;
+        }
+        chunks[i].base = data;
+        chunks[i].cursor = start;
+        chunks[i].end = end;
+        chunks[i].pool = *pool;
+        chunks[i].pool.slabs = NULL;
+        chunks[i].pool.cursor = chunks[i].pool.end = NULL;
+        chunks[i].pool.freeList = NULL;
+        chunks[i].pool.slabObjects = POOL_FIRST_SLAB;
+        chunks[i].parse = parse;
+        start = end;
+    }
+
+#ifndef _WIN32
+    pthread_t threads[LOAD_MAX_THREADS];
+    int started[LOAD_MAX_THREADS];
+    for (i = 1; i < n; i++) started[i] = pthread_create(&threads[i], NULL, runLoadChunk, &chunks[i]) == 0;
+    parse(&chunks[0]);
+    for (i = 1; i < n; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+        else parse(&chunks[i]);
+    }
+#else
+    for (i = 0; i < n; i++) parse(&chunks[i]);
+#endif
+
+    for (i = 0; i < n; i++) poolAdopt(pool, &chunks[i].pool);
+    unmapFile(data, size);
+    *count = n;
+    return chunks;
+}
+
+// =================== Loan Table ===================
+
+// Column copy of the loan list, in list order, for the report scans: a
+// type byte and three ints per loan instead of a 60-byte node per pointer
+// hop. The list stays the primary store; everything that appends to it or
+// rebuilds it keeps the table in step.
+//
+// The rows of each student are also chained together, so a student's
+// history costs as many steps as it has rows, not a pass over the table.
+typedef struct {
+    int first;  // -1 = no rows
+    int last;
+} LoanChain;
+
+typedef struct {
+    unsigned char* type;  // 0 = loan, 1 = return, 2 = anything else
+    int* student;         // internHolder(studentID)
+    int* copy;            // internKey(&loanLabels, label)
+    int* day;
+    int* nextForStudent;  // next row with the same student, -1 = last
+    LoanRecord** record;  // row -> list node, for printing
+    int count;
+    int capacity;
+    LoanChain* chains;    // by student handle
+    int chainCount;
+} LoanTable;
+
+static LoanTable loanTable;
+static Interner loanLabels;
+
+void loanTableAppend(LoanRecord* record) {
+    LoanTable* t = &loanTable;
+    if (t->count == t->capacity) {
+        t->capacity = t->capacity ? t->capacity * 2 : 1024;
+        t->type = realloc(t->type, t->capacity);
+        t->student = realloc(t->student, t->capacity * sizeof(int));
+        t->copy = realloc(t->copy, t->capacity * sizeof(int));
+        t->day = realloc(t->day, t->capacity * sizeof(int));
+        t->nextForStudent = realloc(t->nextForStudent, t->capacity * sizeof(int));
+        t->record = realloc(t->record, t->capacity * sizeof(LoanRecord*));
+    }
+    int student = internHolder(record->studentID);
+    if (student >= t->chainCount) {
+        int grown = (student + 1) * 2;
+        t->chains = realloc(t->chains, grown * sizeof(LoanChain));
+        for (; t->chainCount < grown; t->chainCount++) t->chains[t->chainCount].first = t->chains[t->chainCount].last = -1;
+    }
+    LoanChain* chain = &t->chains[student];
+    if (chain->last >= 0) t->nextForStudent[chain->last] = t->count;
+    else chain->first = t->count;
+    chain->last = t->count;
+
+    t->type[t->count] = record->type == 0 ? 0 : record->type == 1 ? 1 : 2;
+    t->student[t->count] = student;
+    t->copy[t->count] = internKey(&loanLabels, record->label);
+    t->day[t->count] = record->day;
+    t->nextForStudent[t->count] = -1;
+    t->record[t->count] = record;
+    t->count++;
+}
+
+void loanTableRebuild(LoanRecord* head) {
+    int i;
+    loanTable.count = 0;
+    for (i = 0; i < loanTable.chainCount; i++) loanTable.chains[i].first = loanTable.chains[i].last = -1;
+    for (; head != NULL; head = head->next) loanTableAppend(head);
+}
+
+// Rows are selected by type (-1 = any), student (0 = any) and a day range.
+typedef struct {
+    int type;
+    int student;
+    int fromDay;  // inclusive
+    int toDay;    // exclusive
+} LoanFilter;
+
+#define LOAN_FILTER_ALL { -1, 0, INT_MIN, INT_MAX }
+#define LOAN_SCAN_BATCH 4096 // rows per filterLoans call in the scans below
+
+// Writes the rows in [from, to) that match f to rows (room for to - from)
+// and returns how many there are. Compares 8 rows per step with AVX2, 4
+// with SSE2, one at a time otherwise.
+int filterLoans(const LoanTable* t, const LoanFilter* f, int from, int to, int* rows) {
+    int n = 0;
+    int i = from;
+#if defined(__AVX2__)
+    const __m256i type = _mm256_set1_epi32(f->type);
+    const __m256i student = _mm256_set1_epi32(f->student);
+    const __m256i fromDay = _mm256_set1_epi32(f->fromDay);
+    const __m256i toDay = _mm256_set1_epi32(f->toDay);
+    for (; i + 8 <= to; i += 8) {
+        __m256i day = _mm256_loadu_si256((const __m256i*)(t->day + i));
+        __m256i m = _mm256_andnot_si256(_mm256_cmpgt_epi32(fromDay, day), _mm256_cmpgt_epi32(toDay, day));
+        if (f->type >= 0) {
+            __m256i types = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(t->type + i)));
+            m = _mm256_and_si256(m, _mm256_cmpeq_epi32(types, type));
+        }
+        if (f->student) {
+            __m256i students = _mm256_loadu_si256((const __m256i*)(t->student + i));
+            m = _mm256_and_si256(m, _mm256_cmpeq_epi32(students, student));
+        }
+        unsigned int bits = _mm256_movemask_ps(_mm256_castsi256_ps(m));
+        while (bits) {
+            rows[n++] = i + lowestBit(bits);
+            bits &= bits - 1;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i type = _mm_set1_epi32(f->type);
+    const __m128i student = _mm_set1_epi32(f->student);
+    const __m128i fromDay = _mm_set1_epi32(f->fromDay);
+    const __m128i toDay = _mm_set1_epi32(f->toDay);
+    for (; i + 4 <= to; i += 4) {
+        __m128i day = _mm_loadu_si128((const __m128i*)(t->day + i));
+        __m128i m = _mm_andnot_si128(_mm_cmpgt_epi32(fromDay, day), _mm_cmpgt_epi32(toDay, day));
+        if (f->type >= 0) {
+            int packed;
+            memcpy(&packed, t->type + i, sizeof(packed));
+            __m128i types = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+            m = _mm_and_si128(m, _mm_cmpeq_epi32(types, type));
+        }
+        if (f->student) {
+            __m128i students = _mm_loadu_si128((const __m128i*)(t->student + i));
+            m = _mm_and_si128(m, _mm_cmpeq_epi32(students, student));
+        }
+        unsigned int bits = _mm_movemask_ps(_mm_castsi128_ps(m));
+        while (bits) {
+            rows[n++] = i + lowestBit(bits);
+            bits &= bits - 1;
+        }
+    }
+#endif
+    for (; i < to; i++) {
+        if (t->day[i] < f->fromDay || t->day[i] >= f->toDay) continue;
+        if (f->type >= 0 && t->type[i] != f->type) continue;
+        if (f->student && t->student[i] != f->student) continue;
+        rows[n++] = i;
+    }
+    return n;
+}
+
+// --- (student, copy) -> row ---
+// Pairs loans with returns in one pass instead of rescanning the history
+// for every record.
+typedef struct {
+    unsigned long long* keys;  // 0 = empty; copy handles start at 1
+    int* rows;
+    size_t capacity;           // power of two, or 0
+    size_t count;
+} PairIndex;
+
+unsigned long long pairKey(const LoanTable* t, int row) {
+    return (unsigned long long)(unsigned int)t->student[row] << 32 | (unsigned int)t->copy[row];
+}
+
+void pairIndexFree(PairIndex* p) {
+    free(p->keys);
+    free(p->rows);
+}
+
+size_t pairSlot(const PairIndex* p, unsigned long long key) {
+    size_t i = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (p->capacity - 1);
+    while (p->keys[i] && p->keys[i] != key) i = (i + 1) & (p->capacity - 1);
+    return i;
+}
+
+// Row stored for key, or -1. With add, stores row if key is new.
+int pairIndexFind(PairIndex* p, unsigned long long key, int add, int row) {
+    if (p->capacity) {
+        size_t i = pairSlot(p, key);
+        if (p->keys[i]) return p->rows[i];
+    }
+    if (!add) return -1;
+
+    if ((p->count + 1) * 2 > p->capacity) {
+        PairIndex old = *p;
+        size_t j;
+        p->capacity = old.capacity ? old.capacity * 2 : 1024;
+        p->keys = calloc(p->capacity, sizeof(unsigned long long));
+        p->rows = malloc(p->capacity * sizeof(int));
+        for (j = 0; j < old.capacity; j++) {
+            if (!old.keys[j]) continue;
+            size_t i = pairSlot(p, old.keys[j]);
+            p->keys[i] = old.keys[j];
+            p->rows[i] = old.rows[j];
+        }
+        pairIndexFree(&old);
+    }
+    size_t i = pairSlot(p, key);
+    p->keys[i] = key;
+    p->rows[i] = row;
+    p->count++;
+    return row;
+}
+
+// Indexes the first row of each (student, copy) pair among the rows of the
+// given type.
+void pairFirstRows(PairIndex* p, int type) {
+    int rows[LOAN_SCAN_BATCH];
+    LoanFilter f = LOAN_FILTER_ALL;
+    int from, n, i;
+    f.type = type;
+    memset(p, 0, sizeof(*p));
+    for (from = 0; from < loanTable.count; from += LOAN_SCAN_BATCH) {
+        int to = from + LOAN_SCAN_BATCH < loanTable.count ? from + LOAN_SCAN_BATCH : loanTable.count;
+        n = filterLoans(&loanTable, &f, from, to, rows);
+        for (i = 0; i < n; i++) pairIndexFind(p, pairKey(&loanTable, rows[i]), 1, rows[i]);
+    }
+}
+
+// =================== Student Functions ===================
+static Student* lastStudent; // tail of the student list, so adding is O(1)
+
+Student* addStudent(Student* head, char* id, char* first, char* last) {
+    Student* newStudent = poolAlloc(&studentPool);
+    strcpy(newStudent->id, id);
+    strcpy(newStudent->firstName, first);
+    strcpy(newStudent->lastName, last);
+    newStudent->points = 100;
+    newStudent->holder = internHolder(newStudent->id);
+    newStudent->next = NULL;
+    newStudent->prev = NULL;
+    indexInsert(&studentIndex, newStudent->id, newStudent);
+
+    Student* tail = head ? lastStudent : NULL;
+    lastStudent = newStudent;
+    if (!head) return newStudent;
+
+    tail->next = newStudent;
+    newStudent->prev = tail;
+    return head;
+}
+
+// points, when given, holds each student's points in list order and is
+// written instead of the live values (see studentPoints).
+void writeStudentRows(Student* head, const int* points) {
+    double start = wallClock();
+    FILE* file = openReplacement("Ogrenciler.csv", "w");
+    if (!file) {
+        printf("Could not open file for writing.\n");
+        return;
+    }
+
+    long long bytes = 0, count = 0;
+    while (head) {
+        bytes += fprintf(file, "%s,%s,%s,%d\n", head->id, head->firstName, head->lastName,
+                         points ? points[count] : head->points);
+        head = head->next;
+        count++;
+    }
+
+    if (!commitReplacement(file, "Ogrenciler.csv")) printf("Could not write Ogrenciler.csv.\n");
+    recordMetric(METRIC_WRITE_STUDENTS, start, bytes, count);
+}
+
+void writeStudentsToFile(Student* head) {
+    writeStudentRows(head, NULL);
+}
+
+// Commit lock held. Copies every student's points, so writePending can
+// write the file after releasing the lock while returns change them.
+int* studentPoints(Student* head) {
+    long count = 0;
+    Student* s;
+    for (s = head; s != NULL; s = s->next) count++;
+    int* points = malloc((count ? count : 1) * sizeof(int));
+    if (!points) return NULL;
+    for (count = 0, s = head; s != NULL; s = s->next) points[count++] = s->points;
+    return points;
+}
+
+
+void parseStudentChunk(LoadChunk* chunk) {
+    char line[200];
+    Student* tail = NULL;
+
+    while (nextLine(chunk, line, sizeof(line)) >= 0) {
+        Student* s = poolAlloc(&chunk->pool);
+        sscanf(line, "%8[^,],%49[^,],%49[^,],%d", s->id, s->firstName, s->lastName, &s->points);
+        s->next = NULL;
+        s->prev = tail;
+
+        if (!tail) chunk->head = s;
+        else tail->next = s;
+        tail = s;
+    }
+    chunk->tail = tail;
+}
+
+Student* readStudentsFromFile() {
+    double start = wallClock();
+    long long loaded = 0;
+    int count, i;
+    LoadChunk* chunks = loadChunks("Ogrenciler.csv", parseStudentChunk, &studentPool, &count);
+    if (!chunks) return NULL;
+
+    Student* head = NULL;
+    Student* tail = NULL;
+    for (i = 0; i < count; i++) {
+        Student* first = chunks[i].head;
+        if (!first) continue;
+        if (!head) head = first;
+        else {
+            tail->next = first;
+            first->prev = tail;
+        }
+        tail = chunks[i].tail;
+    }
+    free(chunks);
+
+    lastStudent = tail;
+
+    // In file order, so the first of two duplicate IDs wins as before
+    Student* s;
+    for (s = head; s != NULL; s = s->next, loaded++) {
+        indexInsert(&studentIndex, s->id, s);
+        s->holder = internHolder(s->id);
+    }
+    recordMetric(METRIC_READ_STUDENTS, start, 0, loaded);
+    return head;
+}
+
+int deleteStudent(Student** head, const char* id) {
+    Student* current = findStudent(id);
+    if (!current) return 0;  // not found
+
+    if (current->prev) current->prev->next = current->next;
+    else *head = current->next;
+
+    if (current->next) current->next->prev = current->prev;
+    else lastStudent = current->prev;
+
+    indexRemove(&studentIndex, current->id, current);
+    poolFree(&studentPool, current);
+    return 1;  // success
+}
+
+int updateStudent(Student* head, const char* id, const char* newFirst, const char* newLast) {
+    Student* s = findStudent(id);
+    if (!s) return 0;
+    strcpy(s->firstName, newFirst);
+    strcpy(s->lastName, newLast);
+    return 1;
+}
+
+void showStudentInfo(Student* head, LoanRecord* loans, const char* id) {
+    double start = wallClock();
+    Student* s = findStudent(id);
+    if (!s) {
+        fprintf(OUT, "Student not found.\n");
+        return;
+    }
+
+    // Follow the student's chain under the commit lock (other threads
+    // append to the table) and print the records after releasing it.
+    LoanRecord** history = NULL;
+    int count = 0, capacity = 0, row, i;
+
+    lockCommit();
+    int points = s->points;
+    row = s->holder < loanTable.chainCount ? loanTable.chains[s->holder].first : -1;
+    for (; row >= 0; row = loanTable.nextForStudent[row]) {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            history = realloc(history, capacity * sizeof(LoanRecord*));
+        }
+        history[count++] = loanTable.record[row];
+    }
+    unlockCommit();
+
+    fprintf(OUT, "\nStudent Info:\n");
+    fprintf(OUT, "ID: %s\nName: %s %s\nPoints: %d\n", s->id, s->firstName, s->lastName, points);
+    fprintf(OUT, "Loan History:\n");
+
+    for (i = 0; i < count; i++) {
+        char date[11];
+        formatDate(history[i]->day, date);
+        fprintf(OUT, "- %s [%s] on %s\n", history[i]->label, history[i]->type == 0 ? "LOAN" : "RETURN", date);
+    }
+    free(history);
+    recordMetric(METRIC_STUDENT_INFO, start, 0, count);
+}
+
+// One pass over the open loans, printing each borrower once.
+void listStudentsWithUnreturnedBooks(Student* students, LoanRecord* loans) {
+    double start = wallClock();
+    printf("\n--- Student that havent return books ---\n");
+    StringIndex printed = {NULL, 0, 0, 0};
+    int i;
+    for (i = 0; i < openLoanCount; i++) {
+        Student* s = findStudent(openLoans[i]->studentID);
+        if (!s || indexFind(&printed, s->id)) continue;
+        indexInsert(&printed, s->id, s);
+        printf("ID: %s | %s %s\n", s->id, s->firstName, s->lastName);
+    }
+    free(printed.slots);
+    recordMetric(METRIC_UNRETURNED, start, 0, openLoanCount);
+}
+
+
+typedef struct {
+    Student* student;
+    int delay;  // days between the loan and the return
+} LateReturn;
+
+// Visits every return made more than LOAN_PERIOD days after the loan, until visit
+// returns 0. Each return is measured against the first loan of the same
+// copy by the same student. Returns how many loan rows were examined.
+long scanLateReturns(int (*visit)(const LateReturn*, void*), void* context) {
+    PairIndex firstLoan;
+    pairFirstRows(&firstLoan, 0);
+
+    int rows[LOAN_SCAN_BATCH];
+    LoanFilter f = LOAN_FILTER_ALL;
+    int from, n, i;
+    f.type = 1; // returns
+    for (from = 0; from < loanTable.count; from += LOAN_SCAN_BATCH) {
+        int to = from + LOAN_SCAN_BATCH < loanTable.count ? from + LOAN_SCAN_BATCH : loanTable.count;
+        n = filterLoans(&loanTable, &f, from, to, rows);
+        for (i = 0; i < n; i++) {
+            int loan = pairIndexFind(&firstLoan, pairKey(&loanTable, rows[i]), 0, 0);
+            if (loan < 0) continue;
+
+            LateReturn late;
+            late.delay = loanTable.day[rows[i]] - loanTable.day[loan];
+            if (late.delay <= LOAN_PERIOD) continue;
+            late.student = findStudent(loanTable.record[rows[i]]->studentID);
+            if (late.student && !visit(&late, context)) {
+                pairIndexFree(&firstLoan);
+                return to;
+            }
+        }
+    }
+    pairIndexFree(&firstLoan);
+    return loanTable.count;
+}
+
+int printLateReturn(const LateReturn* late, void* context) {
+    Student* s = late->student;
+    printf("ID: %s | %s %s | Late Return: %d day\n", s->id, s->firstName, s->lastName, late->delay);
+    return 1;
+}
+
+void listPenalizedStudents(Student* students, LoanRecord* loans) {
+    double start = wallClock();
+    printf("\n--- Penalized Students ---\n");
+    long scanned = scanLateReturns(printLateReturn, NULL);
+    recordMetric(METRIC_PENALIZED, start, 0, scanned);
+}
+
+
+
+
+void listAllStudents(Student* head) {
+    double start = wallClock();
+    long long count = 0;
+    printf("\n--- All Students ---\n");
+    while (head) {
+        printf("ID: %s | Name: %s %s | Points: %d\n", head->id, head->firstName, head->lastName, head->points);
+        head = head->next;
+        count++;
+    }
+    recordMetric(METRIC_ALL_STUDENTS, start, 0, count);
+}
+
+
+
+// book operation functions 
+
+void op_addBook(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    char title[100], isbn[14];
+    int quantity;
+    printf("Enter book title: ");
+    scanf(" %[^\n]", title);
+    printf("Enter ISBN: ");
+    scanf("%s", isbn);
+    if (bookExists(*bookList, isbn)) {
+        printf("Book already exists.\n");
+        return;
+    }
+    printf("Enter quantity: ");
+    scanf("%d", &quantity);
+    lockLibrary(1);
+    *bookList = addBook(*bookList, title, isbn, quantity);
+    writeBooksAfterJournal(*bookList, loanList);
+    unlockLibrary();
+    printf("Book added.\n");
+}
+
+void op_deleteBook(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    char isbn[14];
+    printf("Enter ISBN to delete: ");
+    scanf("%s", isbn);
+    lockLibrary(1);
+    *bookList = deleteBookByISBN(*bookList, isbn);
+    writeBooksAfterJournal(*bookList, loanList);
+    unlockLibrary();
+    printf("Book deleted.\n");
+}
+void op_updateBook(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    char isbn[14], newTitle[100];
+    printf("Enter ISBN to update: ");
+    scanf("%s", isbn);
+    printf("New Title: ");
+    scanf(" %[^\n]", newTitle);
+    lockLibrary(1);
+    int updated = updateBookTitle(*bookList, isbn, newTitle);
+    if (updated) writeBooksAfterJournal(*bookList, loanList);
+    unlockLibrary();
+    printf(updated ? "Book title updated.\n" : "Book not found.\n");
+}
+void op_viewBookByTitle(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    char title[100];
+    printf("Enter title to search: ");
+    scanf(" %[^\n]", title);
+    lockLibrary(0);
+    showBookInfoByTitle(*bookList, title);
+    unlockLibrary();
+}
+void op_searchBooks(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    char query[100];
+    printf("Enter part of the title: ");
+    scanf(" %99[^\n]", query);
+    lockLibrary(0);
+    searchBooks(*bookList, query);
+    unlockLibrary();
+}
+void op_listBooksOnShelf(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    lockLibrary(0);
+    listBooksOnShelf(*bookList);
+    unlockLibrary();
+}
+void op_listAllBooks(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    double start = wallClock();
+    long long count = 0;
+    Book* b;
+    BookCopy* c;
+    lockLibrary(0);
+    for (b = *bookList; b != NULL; b = b->next) {
+        printf("Book: %s, ISBN: %s, Qty: %d\n", b->title, b->isbn, b->quantity);
+        showAuthorsForBook(b->isbn, authorList, manager);
+        char label[30];
+        for (c = b->copies; c < b->copies + b->copyCount; c++) {
+            printf("   Copy: %s, Status: %s\n", copyLabel(b, c, label), copyStatus(c));
+        }
+        count += 1 + b->copyCount;
+    }
+    unlockLibrary();
+    recordMetric(METRIC_ALL_BOOKS, start, 0, count);
+}
+void op_listOverdueBooks(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    lockLibrary(0);
+    listOverdueBooks(*loanList);
+    unlockLibrary();
+}
+void op_addBookAuthorMapping(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    char isbn[14];
+    int authorID;
+
+    printf("Enter Book ISBN: ");
+    scanf("%s", isbn);
+    printf("Enter Author ID: ");
+    scanf("%d", &authorID);
+
+    lockLibrary(1);
+    addBookAuthorMapping(manager, isbn, authorID);
+    writeBookAuthorCSV(manager);
+    unlockLibrary();
+    printf("Mapping added: Book %s  Author %d\n", isbn, authorID);
+}
+void op_updateBookAuthors(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    char isbn[14];
+    printf("Enter Book ISBN to update authors: ");
+    scanf("%s", isbn);
+    updateBookAuthors(manager, isbn);
+}
+
+
+// =================== Book Functions ===================
+BookCopy* createBookCopies(int quantity) {
+    if (quantity <= 0) return NULL;
+    BookCopy* copies = calloc(quantity, sizeof(BookCopy)); // all "RAFTA"
+    int i;
+    for (i = 0; i < quantity; i++) copies[i].number = i + 1;
+    return copies;
+}
+
+static Book* lastBook; // tail of the book list, so adding is O(1)
+
+Book* addBook(Book* head, char* title, char* isbn, int quantity) {
+    Book* newBook = poolAlloc(&bookPool);
+    strcpy(newBook->title, title);
+    strcpy(newBook->isbn, isbn);
+    newBook->quantity = quantity;
+    newBook->copies = createBookCopies(quantity);
+    newBook->copyCount = newBook->copies ? quantity : 0;
+    newBook->onShelf = NULL;
+    newBook->copiesOffset = -1;
+    newBook->next = NULL;
+    buildShelfBitmap(newBook);
+    indexInsert(&bookIndex, newBook->isbn, newBook);
+    titleIndexAdd(newBook);
+
+    Book* tail = head ? lastBook : NULL;
+    lastBook = newBook;
+    if (!head) return newBook;
+
+    tail->next = newBook;
+    return head;
+}
+
+Book* deleteBookByISBN(Book* head, const char* isbn) {
+    Book* curr = head;
+    Book* prev = NULL;
+
+    if (!findBook(isbn)) return head; // not found
+
+    while (curr) {
+        if (strcmp(curr->isbn, isbn) == 0) {
+            if (prev) prev->next = curr->next;
+            else head = curr->next;
+            if (lastBook == curr) lastBook = prev;
+
+            indexRemove(&bookIndex, curr->isbn, curr);
+            titleIndexRemove(curr);
+            free(curr->onShelf);
+
+            // free copies; their loans can no longer be returned
+            int i;
+            char label[30];
+            for (i = 0; i < curr->copyCount; i++) {
+                copyLabel(curr, &curr->copies[i], label);
+                LoanRecord* open = indexFind(&openLoanIndex, label);
+                if (open) {
+                    setOutstanding(open, 0); // off the due-date heap too, as a return would
+                    indexRemove(&openLoanIndex, open->label, open);
+                }
+            }
+            unmarkBookDirty(curr);
+            free(curr->copies);
+            poolFree(&bookPool, curr);
+            return head;
+        }
+        prev = curr;
+        curr = curr->next;
+    }
+
+    return head; // not found
+}
+
+int updateBookTitle(Book* head, const char* isbn, const char* newTitle) {
+    Book* b = findBook(isbn);
+    if (!b) return 0;
+    titleIndexRemove(b);
+    strcpy(b->title, newTitle);
+    titleIndexAdd(b);
+    return 1;
+}
+int bookExists(Book* head, const char* isbn) {
+    return findBook(isbn) != NULL;
+}
+
+
+// Copy statuses are written as fixed-width fields ("RAFTA" is space padded
+// to the width of a student ID) so a borrow or return can overwrite a single
+// field in place instead of regenerating the whole file.
+#define STATUS_FIELD_WIDTH 8
+
+typedef struct {
+    Book* book;
+    BookCopy* copy;
+} DirtyCopy;
+
+static DirtyCopy* dirtyCopies;
+static int dirtyCount;
+static int dirtyCapacity;
+
+void markCopyDirty(Book* b, BookCopy* c) {
+    if (c->dirty) return;
+    if (dirtyCount == dirtyCapacity) {
+        dirtyCapacity = dirtyCapacity ? dirtyCapacity * 2 : 16;
+        dirtyCopies = realloc(dirtyCopies, dirtyCapacity * sizeof(DirtyCopy));
+    }
+    c->dirty = 1;
+    dirtyCopies[dirtyCount].book = b;
+    dirtyCopies[dirtyCount].copy = c;
+    dirtyCount++;
+}
+
+// Called before a book is freed so the pending queue never holds a stale pointer.
+void unmarkBookDirty(Book* b) {
+    int i = 0;
+    while (i < dirtyCount) {
+        if (dirtyCopies[i].book == b) dirtyCopies[i] = dirtyCopies[--dirtyCount];
+        else i++;
+    }
+}
+
+// Position of a copy's status field in Kitaplar.csv, worked out from the
+// lengths of the fixed-width copy lines before it, or -1 if unknown.
+long statusOffset(const Book* b, const BookCopy* c) {
+    if (b->copiesOffset < 0) return -1;
+    long offset = b->copiesOffset;
+    long isbnLength = strlen(b->isbn);
+    const BookCopy* k;
+    for (k = b->copies; ; k++) {
+        long labelLength = isbnLength + 1;
+        int n;
+        for (n = k->number; n > 0; n /= 10) labelLength++;
+        if (k == c) return offset + labelLength + 1;
+        offset += labelLength + 1 + STATUS_FIELD_WIDTH + 1;
+    }
+}
+
+void writeBooksToFile(Book* head) {
+    double start = wallClock();
+    FILE* file = openReplacement("Kitaplar.csv", "wb");
+    if (!file) {
+        printf("Couldn't write to Kitaplar.csv\n");
+        return;
+    }
+    Book* b;
+    long long lines = 0;
+    for (b = head; b != NULL; b = b->next) {
+        fprintf(file, "%s,%s,%d\n", b->title, b->isbn, b->quantity);
+        lines += 1 + b->copyCount;
+        b->copiesOffset = ftell(file);
+        BookCopy* copy;
+        for (copy = b->copies; copy < b->copies + b->copyCount; copy++) {
+            const char* status = copyStatus(copy);
+            if (strlen(status) > STATUS_FIELD_WIDTH) b->copiesOffset = -1;
+            fprintf(file, "%s_%d,%-*s\n", b->isbn, copy->number, STATUS_FIELD_WIDTH, status);
+        }
+    }
+    long bytes = ftell(file);
+    int written = commitReplacement(file, "Kitaplar.csv");
+    recordMetric(METRIC_WRITE_BOOKS, start, bytes, lines);
+    if (!written) {
+        // The old file is still there and its layout is unknown
+        printf("Couldn't write to Kitaplar.csv\n");
+        for (b = head; b != NULL; b = b->next) b->copiesOffset = -1;
+        return;
+    }
+
+    int i;
+    for (i = 0; i < dirtyCount; i++) dirtyCopies[i].copy->dirty = 0;
+    dirtyCount = 0;
+}
+
+// A pending status change taken off the dirty queue, with the status as
+// it was then, so it can be written without the commit lock.
+struct StatusPatch {
+    Book* book;
+    BookCopy* copy;
+    char status[STATUS_FIELD_WIDTH + 1];
+};
+
+// Commit lock held. Whether every pending status can be overwritten in
+// place: not if a book's copy lines are not all fixed width (e.g. the file
+// was written by an older version) or a status is too long for the field.
+int copyStatusesPatchable(void) {
+    int i;
+    for (i = 0; i < dirtyCount; i++) {
+        if (dirtyCopies[i].book->copiesOffset < 0 || strlen(copyStatus(dirtyCopies[i].copy)) > STATUS_FIELD_WIDTH)
+            return 0;
+    }
+    return 1;
+}
+
+// Commit lock held. Empties the dirty queue into *patches (malloc'd).
+int takeCopyStatuses(StatusPatch** patches) {
+    int i, count = dirtyCount;
+    *patches = count ? malloc(count * sizeof(StatusPatch)) : NULL;
+    if (count && !*patches) return 0; // stay queued
+    for (i = 0; i < count; i++) {
+        (*patches)[i].book = dirtyCopies[i].book;
+        (*patches)[i].copy = dirtyCopies[i].copy;
+        strcpy((*patches)[i].status, copyStatus(dirtyCopies[i].copy));
+        dirtyCopies[i].copy->dirty = 0;
+    }
+    dirtyCount = 0;
+    return count;
+}
+
+// Commit lock held. Puts taken statuses back after a failed write; the
+// copy's current status is what gets written next time.
+void requeueCopyStatuses(const StatusPatch* patches, int count) {
+    int i;
+    for (i = 0; i < count; i++) markCopyDirty(patches[i].book, patches[i].copy);
+}
+
+// Write lock held. Persists taken status changes with positioned writes.
+// Returns 0 if the file couldn't be patched.
+int saveCopyStatuses(const StatusPatch* patches, int count) {
+    int i;
+    if (count == 0) return 1;
+    double start = wallClock();
+    FILE* file = fopen("Kitaplar.csv", "r+b");
+    if (!file) return 0;
+    int ok = 1;
+    for (i = 0; i < count && ok; i++) {
+        if (fseek(file, statusOffset(patches[i].book, patches[i].copy), SEEK_SET) != 0 ||
+            fprintf(file, "%-*s", STATUS_FIELD_WIDTH, patches[i].status) < 0) ok = 0;
+    }
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) {
+        // Some fields may be half written; the caller regenerates the file
+        printf("Couldn't update copy statuses in Kitaplar.csv, rewriting it.\n");
+        return 0;
+    }
+    recordMetric(METRIC_SAVE_STATUSES, start, (long long)count * STATUS_FIELD_WIDTH, count);
+    return 1;
+}
+
+// Parses a copy line ("ISBN_N,status") into c and the label's ISBN part
+// into isbn. Returns 1 if the line has the fixed-width form
+// writeBooksToFile produces, so its status can be overwritten in place.
+int parseCopyLine(const char* line, BookCopy* c, char* isbn) {
+    char label[30] = "";
+    char status[20] = "RAFTA";
+    sscanf(line, "%29[^,],%19s", label, status);
+    c->holder = internHolder(status);
+    c->dirty = 0;
+    c->number = 0;
+    isbn[0] = '\0';
+
+    const char* sep = strrchr(label, '_');
+    if (!sep || sep - label > 13) return 0;
+    memcpy(isbn, label, sep - label);
+    isbn[sep - label] = '\0';
+    c->number = atoi(sep + 1);
+    char digits[12];
+    sprintf(digits, "%d", c->number);
+
+    const char* field = strchr(line, ',');
+    return field && c->number >= 1 && strcmp(digits, sep + 1) == 0 &&
+           strcspn(field + 1, "\r\n") == STATUS_FIELD_WIDTH && field[1 + STATUS_FIELD_WIDTH] != '\r';
+}
+
+void appendCopy(BookCopy** copies, int* count, int* capacity, const BookCopy* c) {
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 4;
+        *copies = realloc(*copies, *capacity * sizeof(BookCopy));
+    }
+    (*copies)[(*count)++] = *c;
+}
+
+// Copy lines belong to the book line above them. A chunk can start in the
+// middle of a book's copies; those lines are kept as orphans and attached
+// to the last book of the previous chunks when the lists are linked.
+void parseBookChunk(LoadChunk* chunk) {
+    char line[256];
+    char isbn[14];
+    Book* currentBook = NULL;
+    BookCopy** copies = &chunk->orphans; // array the next copy line goes to
+    int* count = &chunk->orphanCount;
+    int capacity = 0;
+    int fixed = 1;
+
+    while (nextLine(chunk, line, sizeof(line)) >= 0) {
+        // Check if line contains book info or copy info
+        if (strchr(line, ',') && !strchr(line, '_')) {
+            // New book entry
+            Book* b = poolAlloc(&chunk->pool);
+            sscanf(line, " %99[^,],%13[^,],%d", b->title, b->isbn, &b->quantity);
+            b->copies = NULL;
+            b->onShelf = NULL;
+            b->copyCount = 0;
+            b->copiesOffset = chunk->cursor - chunk->base;
+            b->next = NULL;
+
+            if (currentBook) {
+                if (!fixed) currentBook->copiesOffset = -1;
+                currentBook->next = b;
+            } else {
+                chunk->head = b;
+                if (!fixed) chunk->orphanIsbn[0] = '\0';
+            }
+            currentBook = b;
+            copies = &b->copies;
+            count = &b->copyCount;
+            capacity = 0;
+            fixed = 1;
+        } else {
+            // BookCopy entry
+            BookCopy c;
+            int canonical = parseCopyLine(line, &c, isbn);
+            if (currentBook) {
+                if (strcmp(isbn, currentBook->isbn) != 0) canonical = 0;
+            } else if (*count == 0) {
+                strcpy(chunk->orphanIsbn, isbn);
+            } else if (strcmp(isbn, chunk->orphanIsbn) != 0) {
+                canonical = 0;
+            }
+            fixed = fixed && canonical;
+            appendCopy(copies, count, &capacity, &c);
+        }
+    }
+    // The last book may still receive orphans from the next chunk
+    chunk->tail = currentBook;
+    if (currentBook) {
+        if (!fixed) currentBook->copiesOffset = -1;
+    } else if (!fixed) {
+        chunk->orphanIsbn[0] = '\0';
+    }
+}
+
+Book* readBooksFromFile() {
+    double start = wallClock();
+    long long loaded = 0;
+    int count, i;
+    LoadChunk* chunks = loadChunks("Kitaplar.csv", parseBookChunk, &bookPool, &count);
+    if (!chunks) return NULL;
+
+    Book* bookList = NULL;
+    Book* currentBook = NULL;
+    for (i = 0; i < count; i++) {
+        // Copy lines before the first book line in the file are ignored
+        if (chunks[i].orphanCount && currentBook) {
+            if (strcmp(chunks[i].orphanIsbn, currentBook->isbn) != 0) currentBook->copiesOffset = -1;
+            currentBook->copies = realloc(currentBook->copies,
+                                          (currentBook->copyCount + chunks[i].orphanCount) * sizeof(BookCopy));
+            memcpy(currentBook->copies + currentBook->copyCount, chunks[i].orphans,
+                   chunks[i].orphanCount * sizeof(BookCopy));
+            currentBook->copyCount += chunks[i].orphanCount;
+        }
+        free(chunks[i].orphans);
+        if (!chunks[i].head) continue;
+
+        if (currentBook) currentBook->next = chunks[i].head;
+        else bookList = chunks[i].head;
+        currentBook = chunks[i].tail;
+    }
+    free(chunks);
+    lastBook = currentBook;
+
+    Book* b;
+    for (b = bookList; b != NULL; b = b->next) {
+        // Trim the growth slack; unnumbered labels get their position
+        if (b->copyCount) b->copies = realloc(b->copies, b->copyCount * sizeof(BookCopy));
+        for (i = 0; i < b->copyCount; i++) {
+            if (b->copies[i].number < 1) b->copies[i].number = i + 1;
+        }
+        buildShelfBitmap(b);
+        indexInsert(&bookIndex, b->isbn, b);
+        titleIndexAdd(b);
+        loaded += 1 + b->copyCount;
+    }
+    recordMetric(METRIC_READ_BOOKS, start, 0, loaded);
+    return bookList;
+}
+// Exact title lookup: only the books filed under the title's rarest
+// trigram are compared.
+Book* findBookByTitle(const char* title) {
+    char normalized[100];
+    unsigned int grams[TITLE_MAX_TRIGRAMS];
+    if (strlen(title) >= sizeof(normalized)) return NULL; // longer than any stored title
+    normalizeTitle(title, normalized);
+    int count = titleTrigrams(normalized, 1, grams);
+
+    TrigramPostings* rarest = NULL;
+    int i;
+    for (i = 0; i < count; i++) {
+        TrigramPostings* p = findPostings(&titleIndex, grams[i]);
+        if (!p || p->count == 0) return NULL;
+        if (!rarest || p->count < rarest->count) rarest = p;
+    }
+    if (!rarest) return NULL;
+    for (i = 0; i < rarest->count; i++) {
+        if (strcmp(rarest->books[i]->title, title) == 0) return rarest->books[i];
+    }
+    return NULL;
+}
+
+void showBookInfoByTitle(Book* head, const char* title) {
+    double start = wallClock();
+    Book* b = findBookByTitle(title);
+    if (!b) {
+        fprintf(OUT, "Book not found.\n");
+        return;
+    }
+    fprintf(OUT, "Title: %s, ISBN: %s, Quantity: %d\n", b->title, b->isbn, b->quantity);
+    lockBook(b->isbn);
+    BookCopy* c;
+    char label[30];
+    for (c = b->copies; c < b->copies + b->copyCount; c++) {
+        fprintf(OUT, "  Copy: %s | Status: %s\n", copyLabel(b, c, label), copyStatus(c));
+    }
+    unlockBook(b->isbn);
+    recordMetric(METRIC_BOOK_INFO, start, 0, b->copyCount);
+}
+
+// --- Title search ---
+#define SEARCH_RESULT_LIMIT 10
+#define SEARCH_MIN_SIMILARITY 0.3 // share of trigrams two titles must have in common
+
+typedef struct {
+    Book* book;
+    int shared;     // query trigrams found in the title
+    int substring;  // title contains the query
+    double score;   // shared / trigrams in either (Jaccard)
+} TitleMatch;
+
+int compareTitleMatches(const void* a, const void* b) {
+    const TitleMatch* x = a;
+    const TitleMatch* y = b;
+    if (x->substring != y->substring) return y->substring - x->substring;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    return strcmp(x->book->title, y->book->title);
+}
+
+// Ranked, case-insensitive title search. Titles containing the query come
+// first, then titles similar enough to be a typo away from it. Candidates
+// are gathered from the query's trigram lists, so only books sharing at
+// least one trigram are looked at. Queries under three letters can't be
+// cut into trigrams and fall back to scanning the list. Returns the number
+// of matches; *matches (up to limit) must be freed by the caller.
+int searchBookTitles(Book* head, const char* query, TitleMatch** matches, int limit) {
+    char q[100], normalized[100];
+    unsigned int grams[TITLE_MAX_TRIGRAMS], inner[TITLE_MAX_TRIGRAMS], titleGrams[TITLE_MAX_TRIGRAMS];
+    int found = 0, capacity = 0, i, j;
+    TitleMatch* list = NULL;
+    *matches = NULL;
+
+    snprintf(normalized, sizeof(normalized), "%s", query);
+    normalizeTitle(normalized, q);
+    if (*q == '\0') return 0;
+    int queryCount = titleTrigrams(q, 1, grams);
+    int innerCount = titleTrigrams(q, 0, inner);
+
+    if (innerCount == 0) {
+        for (; head; head = head->next) {
+            normalizeTitle(head->title, normalized);
+            if (!strstr(normalized, q)) continue;
+            if (found == capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                list = realloc(list, capacity * sizeof(TitleMatch));
+            }
+            list[found].book = head;
+            list[found].shared = 0;
+            list[found].substring = 1;
+            list[found].score = strcmp(normalized, q) == 0 ? 1.0 : (double)strlen(q) / strlen(normalized);
+            found++;
+        }
+    } else {
+        // Count shared trigrams per book in a small open-addressing table
+        size_t total = 0;
+        for (i = 0; i < queryCount; i++) {
+            TrigramPostings* p = findPostings(&titleIndex, grams[i]);
+            if (p) total += p->count;
+        }
+        size_t size = 16;
+        while (size < total * 2) size *= 2;
+        TitleMatch* table = calloc(size, sizeof(TitleMatch));
+        if (!table) return 0;
+        for (i = 0; i < queryCount; i++) {
+            TrigramPostings* p = findPostings(&titleIndex, grams[i]);
+            if (!p) continue;
+            for (j = 0; j < p->count; j++) {
+                size_t slot = ((size_t)p->books[j] >> 4) * 2654435761u & (size - 1);
+                while (table[slot].book && table[slot].book != p->books[j]) slot = (slot + 1) & (size - 1);
+                table[slot].book = p->books[j];
+                table[slot].shared++;
+            }
+        }
+
+        size_t k;
+        for (k = 0; k < size; k++) {
+            TitleMatch* m = &table[k];
+            // Neither a substring (needs every inner trigram) nor similar enough
+            if (!m->book || (m->shared < innerCount && m->shared < SEARCH_MIN_SIMILARITY * queryCount)) continue;
+
+            normalizeTitle(m->book->title, normalized);
+            int titleCount = titleTrigrams(normalized, 1, titleGrams);
+            m->score = (double)m->shared / (queryCount + titleCount - m->shared);
+            m->substring = strstr(normalized, q) != NULL;
+            if (!m->substring && m->score < SEARCH_MIN_SIMILARITY) continue;
+            table[found++] = *m; // compacts in place: found <= k
+        }
+        list = table;
+    }
+
+    qsort(list, found, sizeof(TitleMatch), compareTitleMatches);
+    *matches = list;
+    return found < limit ? found : limit;
+}
+
+void searchBooks(Book* head, const char* query) {
+    double start = wallClock();
+    TitleMatch* matches;
+    int count = searchBookTitles(head, query, &matches, SEARCH_RESULT_LIMIT);
+    if (count == 0) {
+        fprintf(OUT, "No matching books.\n");
+        free(matches);
+        recordMetric(METRIC_SEARCH, start, 0, 0);
+        return;
+    }
+    int i;
+    for (i = 0; i < count; i++) {
+        Book* b = matches[i].book;
+        if (matches[i].substring)
+            fprintf(OUT, "%2d. %s (ISBN: %s, Quantity: %d)\n", i + 1, b->title, b->isbn, b->quantity);
+        else
+            fprintf(OUT, "%2d. %s (ISBN: %s, Quantity: %d) ~%.0f%% similar\n",
+                    i + 1, b->title, b->isbn, b->quantity, matches[i].score * 100);
+    }
+    free(matches);
+    recordMetric(METRIC_SEARCH, start, 0, count);
+}
+void listBooksOnShelf(Book* head) {
+    double start = wallClock();
+    long long count = 0;
+    fprintf(OUT, "\n--- Books on Shelf ---\n");
+    while (head) {
+        lockBook(head->isbn);
+        int slot;
+        char label[30];
+        for (slot = nextOnShelf(head, 0); slot >= 0; slot = nextOnShelf(head, slot + 1), count++) {
+            fprintf(OUT, "Book: %s | Copy: %s\n", head->title, copyLabel(head, &head->copies[slot], label));
+        }
+        unlockBook(head->isbn);
+        head = head->next;
+    }
+    recordMetric(METRIC_SHELF, start, 0, count);
+}
+void trackOpenLoan(LoanRecord* record);
+
+void parseLoanChunk(LoadChunk* chunk) {
+    char line[200];
+    LoanRecord* tail = NULL;
+
+    long at;
+
+    while ((at = nextLine(chunk, line, sizeof(line))) >= 0) {
+        LoanRecord* record = poolAlloc(&chunk->pool);
+        char date[11] = "";
+        int fields = sscanf(line, "%8[^,],%29[^,],%d,%10[^\r\n]",
+                            record->studentID, record->label, &record->type, date);
+        record->day = parseDate(date);
+        record->next = NULL;
+        int complete = fields == 4 && record->day != INVALID_DAY;
+
+        if (chunk->cursor[-1] != '\n') {
+            // A crash while appending can leave a partial last line: keep
+            // it only if it is a complete record
+            chunk->unterminated = 1;
+            chunk->tornAt = complete ? -1 : at;
+            if (!complete) {
+                poolFree(&chunk->pool, record);
+                break;
+            }
+        }
+        if (!complete) {
+            // Left out rather than kept with a made-up date, which the next
+            // rewrite of the file would store for good
+            chunk->skipped++;
+            poolFree(&chunk->pool, record);
+            continue;
+        }
+
+        if (!tail) chunk->head = record;
+        else tail->next = record;
+        tail = record;
+    }
+    chunk->tail = tail;
+}
+
+#ifndef _WIN32
+// Appends must start on a fresh line: cuts a partial last line (starting at
+// tornAt) off LoanRecords.csv, or with tornAt < 0 ends a complete one. The
+// rest of the file is left alone, malformed lines included.
+void repairJournalTail(long tornAt) {
+    int ok;
+    if (tornAt >= 0) {
+        ok = truncate("LoanRecords.csv", tornAt) == 0;
+        if (ok) syncPath("LoanRecords.csv");
+    } else {
+        FILE* f = fopen("LoanRecords.csv", "a");
+        ok = f && fputc('\n', f) != EOF && syncFile(f);
+        if (f && fclose(f) != 0) ok = 0;
+    }
+    if (!ok) printf("Couldn't repair the last line of LoanRecords.csv\n");
+}
+#endif
+
+// Books must be loaded first so each record can be matched to its copy.
+LoanRecord* readLoansFromFile() {
+    double start = wallClock();
+    long long loaded = 0;
+    int count, i;
+    LoanRecord* head = NULL;
+    LoanRecord* tail = NULL;
+    LoadChunk* chunks = loadChunks("LoanRecords.csv", parseLoanChunk, &loanPool, &count);
+    if (!chunks) return NULL;
+
+    int unterminated = 0;
+    long skipped = 0, tornAt = -1;
+    for (i = 0; i < count; i++) {
+        if (chunks[i].unterminated) {
+            unterminated = 1;
+            tornAt = chunks[i].tornAt;
+        }
+        skipped += chunks[i].skipped;
+        if (!chunks[i].head) continue;
+        if (!head) head = chunks[i].head;
+        else tail->next = chunks[i].head;
+        tail = chunks[i].tail;
+    }
+    free(chunks);
+    if (skipped) printf("Skipped %ld malformed line(s) in LoanRecords.csv.\n", skipped);
+
+    // Replayed in file order: a later record supersedes an earlier one
+    LoanRecord* record;
+    for (record = head; record != NULL; record = record->next, loaded++) {
+        trackOpenLoan(record);
+        loanTableAppend(record);
+    }
+
+    loanTail = tail;
+    journalTail = tail;
+    if (unterminated) {
+#ifndef _WIN32
+        repairJournalTail(tornAt);
+#else
+        writeLoansToFile(head); // no truncate(): rewrite without the partial line
+#endif
+    }
+    recordMetric(METRIC_READ_LOANS, start, 0, loaded);
+    return head;
+}
+
+//time functions 
+
+// Dates are kept as a day number (days since 01-01-1970) so differences are
+// plain integer subtraction. The conversions below are pure integer
+// proleptic Gregorian arithmetic: no mktime, no time zone or DST effects.
+int daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;                                   // [0, 399]
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;  // [0, 365]
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;           // [0, 146096]
+    return era * 146097 + doe - 719468;
+}
+
+void civilFromDays(int z, int* y, int* m, int* d) {
+    z += 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = yoe + era * 400 + (*m <= 2);
+}
+
+// Parses "DD-MM-YYYY" (single-digit day/month accepted); INVALID_DAY on
+// error, trailing characters and days past the end of the month included.
+int parseDate(const char* date) {
+    int part[3] = {0, 0, 0};
+    int i;
+    for (i = 0; i < 3; i++) {
+        const char* start = date;
+        while (*date >= '0' && *date <= '9') part[i] = part[i] * 10 + (*date++ - '0');
+        if (date == start || date - start > 4) return INVALID_DAY;
+        if (i < 2 && *date++ != '-') return INVALID_DAY;
+    }
+    if (*date != '\0') return INVALID_DAY;
+    if (part[1] < 1 || part[1] > 12 || part[0] < 1 || part[0] > 31) return INVALID_DAY;
+    // 31-02 would land on 03-03: only a date that converts back unchanged
+    // exists (this also handles leap years)
+    int day = daysFromCivil(part[2], part[1], part[0]);
+    int y, m, d;
+    civilFromDays(day, &y, &m, &d);
+    if (y != part[2] || m != part[1] || d != part[0]) return INVALID_DAY;
+    return day;
+}
+
+// Writes DD-MM-YYYY into out (at least 11 bytes).
+void formatDate(int day, char* out) {
+    int y, m, d;
+    civilFromDays(day, &y, &m, &d);
+    out[0] = '0' + d / 10;
+    out[1] = '0' + d % 10;
+    out[2] = '-';
+    out[3] = '0' + m / 10;
+    out[4] = '0' + m % 10;
+    out[5] = '-';
+    out[6] = '0' + (y / 1000) % 10;
+    out[7] = '0' + (y / 100) % 10;
+    out[8] = '0' + (y / 10) % 10;
+    out[9] = '0' + y % 10;
+    out[10] = '\0';
+}
+
+// Local calendar day of "now".
+int today(void) {
+    time_t t = time(NULL);
+    struct tm tm = *localtime(&t);
+    return daysFromCivil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
+typedef struct {
+    const LoanRecord* loan;
+    int days;      // until the return, or until today
+    int returned;
+} OverdueLoan;
+
+int compareDueLoans(const void* a, const void* b) {
+    const LoanRecord* x = *(LoanRecord* const*)a;
+    const LoanRecord* y = *(LoanRecord* const*)b;
+    if (x->day != y->day) return x->day < y->day ? -1 : 1;
+    return strcmp(x->label, y->label);
+}
+
+// The open loans made before `day`, oldest first. Only the part of the
+// heap above the cutoff is visited: a slot can only qualify if its parent
+// does. The caller frees *due.
+int openLoansBefore(int day, LoanRecord*** due) {
+    int* pending = malloc((openLoanCount + 1) * sizeof(int));
+    int top = 0, count = 0;
+    *due = malloc((openLoanCount + 1) * sizeof(LoanRecord*));
+    if (openLoanCount > 0) pending[top++] = 0;
+    while (top > 0) {
+        int slot = pending[--top];
+        if (openLoans[slot]->day >= day) continue;
+        (*due)[count++] = openLoans[slot];
+        if (2 * slot + 1 < openLoanCount) pending[top++] = 2 * slot + 1;
+        if (2 * slot + 2 < openLoanCount) pending[top++] = 2 * slot + 2;
+    }
+    free(pending);
+    qsort(*due, count, sizeof(LoanRecord*), compareDueLoans);
+    return count;
+}
+
+// Visits every loan kept more than LOAN_PERIOD days, until visit returns
+// 0: first the loans still out, oldest first, straight from the due-date
+// heap, then the loans returned late. Each of those is measured against
+// the first return of the same copy by the same student, or against today
+// if there is none. Returns how many loans were examined.
+long scanOverdueLoans(int (*visit)(const OverdueLoan*, void*), void* context) {
+    int now = today();
+    OverdueLoan overdue;
+    LoanRecord** due;
+    int count = openLoansBefore(now - LOAN_PERIOD, &due), i;
+    overdue.returned = 0;
+    for (i = 0; i < count; i++) {
+        overdue.loan = due[i];
+        overdue.days = now - due[i]->day;
+        if (!visit(&overdue, context)) {
+            free(due);
+            return i + 1;
+        }
+    }
+    free(due);
+
+    PairIndex firstReturn;
+    pairFirstRows(&firstReturn, 1);
+
+    int rows[LOAN_SCAN_BATCH];
+    LoanFilter f = LOAN_FILTER_ALL;
+    int from, n;
+    f.type = 0; // loans
+    for (from = 0; from < loanTable.count; from += LOAN_SCAN_BATCH) {
+        int to = from + LOAN_SCAN_BATCH < loanTable.count ? from + LOAN_SCAN_BATCH : loanTable.count;
+        n = filterLoans(&loanTable, &f, from, to, rows);
+        for (i = 0; i < n; i++) {
+            if (loanTable.record[rows[i]]->openSlot >= 0) continue; // listed above
+            // Loans still out are all on the heap; one without a return that
+            // isn't there was closed by deleting its book
+            int r = pairIndexFind(&firstReturn, pairKey(&loanTable, rows[i]), 0, 0);
+            if (r < 0) continue;
+            overdue.loan = loanTable.record[rows[i]];
+            overdue.returned = 1;
+            overdue.days = loanTable.day[r] - loanTable.day[rows[i]];
+            if (overdue.days > LOAN_PERIOD && !visit(&overdue, context)) {
+                pairIndexFree(&firstReturn);
+                return count + to;
+            }
+        }
+    }
+    pairIndexFree(&firstReturn);
+    return count + loanTable.count;
+}
+
+int printOverdueLoan(const OverdueLoan* overdue, void* context) {
+    const LoanRecord* l = overdue->loan;
+    if (overdue->returned) printf("%s Overdue (%d day) | Student: %s\n", l->label, overdue->days, l->studentID);
+    else printf("%s Still didnt return (%d day passed) | Student: %s\n", l->label, overdue->days, l->studentID);
+    return 1;
+}
+
+void listOverdueBooks(LoanRecord* loans) {
+    double start = wallClock();
+    printf("\n--- Overdue Books ---\n");
+    long scanned = scanOverdueLoans(printOverdueLoan, NULL);
+    recordMetric(METRIC_OVERDUE, start, 0, scanned);
+}
+
+// =================== Loan Record Functions ===================
+
+void swapOpenLoans(int i, int j) {
+    LoanRecord* t = openLoans[i];
+    openLoans[i] = openLoans[j];
+    openLoans[j] = t;
+    openLoans[i]->openSlot = i;
+    openLoans[j]->openSlot = j;
+}
+
+void siftOpenLoan(int slot) {
+    while (slot > 0 && openLoans[slot]->day < openLoans[(slot - 1) / 2]->day) {
+        swapOpenLoans(slot, (slot - 1) / 2);
+        slot = (slot - 1) / 2;
+    }
+    while (1) {
+        int child = 2 * slot + 1, least = slot;
+        if (child < openLoanCount && openLoans[child]->day < openLoans[least]->day) least = child;
+        if (child + 1 < openLoanCount && openLoans[child + 1]->day < openLoans[least]->day) least = child + 1;
+        if (least == slot) return;
+        swapOpenLoans(slot, least);
+        slot = least;
+    }
+}
+
+// Adds a loan to, or removes it from, the due-date heap.
+void setOutstanding(LoanRecord* record, int outstanding) {
+    if (outstanding) {
+        if (openLoanCount == openLoanCapacity) {
+            openLoanCapacity = openLoanCapacity ? openLoanCapacity * 2 : 256;
+            openLoans = realloc(openLoans, openLoanCapacity * sizeof(LoanRecord*));
+        }
+        record->openSlot = openLoanCount;
+        openLoans[openLoanCount++] = record;
+        siftOpenLoan(record->openSlot);
+    } else {
+        int slot = record->openSlot;
+        record->openSlot = -1;
+        if (slot != --openLoanCount) {
+            openLoans[slot] = openLoans[openLoanCount];
+            openLoans[slot]->openSlot = slot;
+            siftOpenLoan(slot);
+        }
+    }
+}
+
+// Keeps openLoanIndex pointing at the loan that is still out for each
+// copy, so a return never has to search the loan history, and keeps the
+// set of outstanding loans in step with it.
+//
+// The journal is also the authority on copy statuses: they are written to
+// Kitaplar.csv after it, so after a crash the file can lag behind or hold a
+// torn field. Replaying the journal on load puts each copy it mentions in
+// the state of its last loan or return (already the case for new records).
+void trackOpenLoan(LoanRecord* record) {
+    record->openSlot = -1;
+    Book* b = NULL;
+    BookCopy* c = findCopyByLabel(record->label, &b);
+    if (!c) return;
+    if (record->type == 0 || record->type == 1) {
+        int holder = record->type == 0 ? internHolder(record->studentID) : 0;
+        if (c->holder != holder) {
+            c->holder = holder;
+            setOnShelf(b, c - b->copies, holder == 0);
+            markCopyDirty(b, c);
+        }
+    }
+    LoanRecord* open = indexFind(&openLoanIndex, record->label);
+    if (open) {
+        setOutstanding(open, 0);
+        indexRemove(&openLoanIndex, open->label, open);
+    }
+    if (record->type == 0) {
+        indexInsert(&openLoanIndex, record->label, record);
+        setOutstanding(record, 1);
+    }
+}
+
+LoanRecord* addLoanRecord(LoanRecord* head, const char* studentID, const char* label, int type, int day) {
+    LoanRecord* newRec = poolAlloc(&loanPool);
+    strcpy(newRec->studentID, studentID);
+    strcpy(newRec->label, label);
+    newRec->type = type;
+    newRec->day = day;
+    newRec->next = NULL;
+    trackOpenLoan(newRec);
+    loanTableAppend(newRec);
+
+    if (!head) {
+        loanTail = newRec;
+        return newRec;
+    }
+
+    // Start from the remembered tail; walking on from it keeps this correct
+    // even if the list was extended elsewhere.
+    LoanRecord* tail = loanTail ? loanTail : head;
+    while (tail->next) tail = tail->next;
+    tail->next = newRec;
+    loanTail = newRec;
+    return head;
+}
+
+
+// Returns 0 if the file couldn't be replaced; it then still holds what it
+// held before and journalTail stays put.
+int writeLoansToFile(LoanRecord* head) {
+    double start = wallClock();
+    FILE* file = openReplacement("LoanRecords.csv", "w");
+    if (!file) {
+        printf("Couldn't write to LoanRecords.csv\n");
+        return 0;
+    }
+    LoanRecord* last = NULL;
+    long long bytes = 0, count = 0;
+    while (head) {
+        char date[11];
+        formatDate(head->day, date);
+        bytes += fprintf(file, "%s,%s,%d,%s\n", head->studentID, head->label, head->type, date);
+        last = head;
+        head = head->next;
+        count++;
+    }
+    if (!commitReplacement(file, "LoanRecords.csv")) {
+        printf("Couldn't write to LoanRecords.csv\n");
+        return 0;
+    }
+    journalTail = last;
+    recordMetric(METRIC_WRITE_LOANS, start, bytes, count);
+    return 1;
+}
+
+// LoanRecords.csv is an append-only journal: only records added since the
+// last write are appended, and startup replays the whole file. Appends the
+// records from first through last (first may be NULL: nothing to do);
+// last->next is never read, so other threads can keep extending the list.
+// Returns 0 if the append failed; the file is then cut back to its old
+// length and journalTail stays put, so the next append retries the same
+// records.
+int appendLoansToFile(LoanRecord* first, const LoanRecord* last) {
+    if (!first) return 1;
+
+    double start = wallClock();
+    FILE* file = fopen("LoanRecords.csv", "a");
+    if (!file) {
+        printf("Couldn't append to LoanRecords.csv\n");
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long oldSize = ftell(file);
+    LoanRecord* r = first;
+    long long bytes = 0, count = 0;
+    int ok = oldSize >= 0;
+    while (ok) {
+        char date[11];
+        formatDate(r->day, date);
+        int n = fprintf(file, "%s,%s,%d,%s\n", r->studentID, r->label, r->type, date);
+        if (n < 0) ok = 0;
+        bytes += n;
+        count++;
+        if (r == last) break;
+        r = r->next;
+    }
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) {
+#ifndef _WIN32
+        if (oldSize >= 0 && truncate("LoanRecords.csv", oldSize) != 0) {
+            printf("Couldn't undo a partial append to LoanRecords.csv\n");
+        }
+#endif
+        printf("Couldn't append to LoanRecords.csv\n");
+        return 0;
+    }
+    journalTail = r;
+    recordMetric(METRIC_APPEND_LOANS, start, bytes, count);
+    return 1;
+}
+
+// =================== Loan Archive ===================
+
+// Loans returned before a cutoff date can be moved out of LoanRecords.csv
+// into LoanArchive.bin, which startup and the reports never read. Each
+// compaction appends one block:
+//   varint count, varint payload length, payload
+// and every archived loan (borrow + return) in the payload is
+//   varint flags             bit 0: student ID as text, bit 1: label as text
+//   student                  number, or varint length + bytes
+//   label                    ISBN and copy number, or varint length + bytes
+//   zigzag varint            loan day - previous loan day in the block
+//   zigzag varint            return day - loan day
+// Loans are sorted by loan day inside a block so the deltas stay small.
+#define ARCHIVE_FILE "LoanArchive.bin"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_MAX_RECORD 64 // bytes one encoded loan can take
+
+typedef struct {
+    char magic[8];
+    unsigned int version;
+} ArchiveHeader;
+
+typedef struct {
+    char studentID[9];
+    char label[30];
+    int loanDay;
+    int returnDay;
+} ArchivedLoan;
+
+unsigned char* putVarint(unsigned char* out, unsigned long long v) {
+    while (v >= 0x80) {
+        *out++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *out++ = (unsigned char)v;
+    return out;
+}
+
+// Returns 0 if the input ends in the middle of a number.
+int getVarint(const unsigned char** in, const unsigned char* end, unsigned long long* v) {
+    int shift = 0;
+    *v = 0;
+    while (*in < end && shift < 64) {
+        unsigned char byte = *(*in)++;
+        *v |= (unsigned long long)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return 1;
+        shift += 7;
+    }
+    return 0;
+}
+
+unsigned long long zigzag(long long v) {
+    return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+long long unzigzag(unsigned long long v) {
+    return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+unsigned char* putText(unsigned char* out, const char* text) {
+    size_t length = strlen(text);
+    out = putVarint(out, length);
+    memcpy(out, text, length);
+    return out + length;
+}
+
+int getText(const unsigned char** in, const unsigned char* end, char* text, size_t size) {
+    unsigned long long length;
+    if (!getVarint(in, end, &length) || length >= size || length > (unsigned long long)(end - *in)) return 0;
+    memcpy(text, *in, length);
+    text[length] = '\0';
+    *in += length;
+    return 1;
+}
+
+// IDs and ISBN_N labels are stored as numbers when they print back the same.
+int numericStudentID(const char* id, unsigned long long* number) {
+    char check[21];
+    if (sscanf(id, "%llu", number) != 1) return 0;
+    snprintf(check, sizeof(check), "%llu", *number);
+    return strcmp(check, id) == 0;
+}
+
+int numericLabel(const char* label, unsigned long long* isbn, unsigned long long* copy) {
+    char check[42];
+    if (sscanf(label, "%llu_%llu", isbn, copy) != 2) return 0;
+    snprintf(check, sizeof(check), "%llu_%llu", *isbn, *copy);
+    return strcmp(check, label) == 0;
+}
+
+int compareArchivedLoans(const void* a, const void* b) {
+    const ArchivedLoan* x = a;
+    const ArchivedLoan* y = b;
+    return x->loanDay < y->loanDay ? -1 : x->loanDay > y->loanDay;
+}
+
+// Cuts LoanArchive.bin back to the length it had before a block was
+// appended, or removes it if the block created it.
+void undoArchiveAppend(long oldSize) {
+    if (oldSize == 0) {
+        remove(ARCHIVE_FILE);
+        return;
+    }
+#ifndef _WIN32
+    if (oldSize >= 0 && truncate(ARCHIVE_FILE, oldSize) != 0) {
+        printf("Couldn't undo a partial append to %s\n", ARCHIVE_FILE);
+    }
+#endif
+}
+
+// Appends one block to LoanArchive.bin, creating the file if needed, and
+// fsyncs it. *oldSize gets the file's length before the append, so the
+// caller can take the block back out with undoArchiveAppend. Returns 0 if
+// the append failed; the file is then already cut back to that length.
+int appendArchiveBlock(ArchivedLoan* loans, long count, long* oldSize) {
+    *oldSize = -1;
+    unsigned char* payload = malloc(count * ARCHIVE_MAX_RECORD);
+    if (!payload) return 0;
+
+    qsort(loans, count, sizeof(ArchivedLoan), compareArchivedLoans);
+    unsigned char* out = payload;
+    int previousDay = 0;
+    long i;
+    for (i = 0; i < count; i++) {
+        unsigned long long student, isbn, copy;
+        int studentIsText = !numericStudentID(loans[i].studentID, &student);
+        int labelIsText = !numericLabel(loans[i].label, &isbn, &copy);
+        out = putVarint(out, studentIsText | labelIsText << 1);
+        if (studentIsText) out = putText(out, loans[i].studentID);
+        else out = putVarint(out, student);
+        if (labelIsText) out = putText(out, loans[i].label);
+        else {
+            out = putVarint(out, isbn);
+            out = putVarint(out, copy);
+        }
+        out = putVarint(out, zigzag((long long)loans[i].loanDay - previousDay));
+        out = putVarint(out, zigzag((long long)loans[i].returnDay - loans[i].loanDay));
+        previousDay = loans[i].loanDay;
+    }
+
+    unsigned char prefix[20];
+    unsigned char* end = putVarint(putVarint(prefix, count), out - payload);
+
+    FILE* f = fopen(ARCHIVE_FILE, "ab");
+    if (!f) {
+        free(payload);
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    *oldSize = ftell(f);
+    int ok = *oldSize >= 0;
+    if (ok && *oldSize == 0) {
+        ArchiveHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "LIBARCH", 8);
+        header.version = ARCHIVE_VERSION;
+        ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    }
+    if (ok) ok = fwrite(prefix, 1, end - prefix, f) == (size_t)(end - prefix);
+    if (ok) ok = fwrite(payload, 1, out - payload, f) == (size_t)(out - payload);
+    if (ok) ok = syncFile(f);
+    if (fclose(f) != 0) ok = 0;
+    free(payload);
+    if (!ok) undoArchiveAppend(*oldSize);
+    else if (*oldSize == 0) syncPath("."); // the new file itself
+    return ok;
+}
+
+// Moves every loan returned before cutoffDay, together with its return,
+// from the live history to the archive and rewrites LoanRecords.csv.
+// Open loans and records that don't pair up stay live. Returns the number
+// of loans archived, or -1 if the archive or LoanRecords.csv couldn't be
+// written; the history is then left as it was, in memory and on disk, so
+// no loan ends up in both files.
+long compactLoanHistory(LoanRecord** loanList, int cutoffDay) {
+    long n = 0, i, archived = 0;
+    LoanRecord* r;
+
+    // Nothing to do unless some return predates the cutoff
+    int rows[LOAN_SCAN_BATCH];
+    LoanFilter f = { 1, 0, INVALID_DAY + 1, cutoffDay };
+    int from, found = 0;
+    for (from = 0; from < loanTable.count && !found; from += LOAN_SCAN_BATCH) {
+        int to = from + LOAN_SCAN_BATCH < loanTable.count ? from + LOAN_SCAN_BATCH : loanTable.count;
+        found = filterLoans(&loanTable, &f, from, to, rows) > 0;
+    }
+    if (!found) return 0;
+
+    for (r = *loanList; r != NULL; r = r->next) n++;
+    if (n == 0) return 0;
+
+    LoanRecord** records = malloc(n * sizeof(LoanRecord*));
+    char* move = calloc(n, 1);
+    ArchivedLoan* loans = malloc((n / 2 + 1) * sizeof(ArchivedLoan));
+    if (!records || !move || !loans) {
+        free(records);
+        free(move);
+        free(loans);
+        return -1;
+    }
+    for (i = 0, r = *loanList; r != NULL; r = r->next) records[i++] = r;
+
+    // Replays the history like trackOpenLoan: label -> position + 1 of the
+    // loan that is out at this point
+    StringIndex open = {NULL, 0, 0, 0};
+    for (i = 0; i < n; i++) {
+        r = records[i];
+        void* current = indexFind(&open, r->label);
+        if (current) indexRemove(&open, r->label, current);
+        if (r->type == 0) {
+            indexInsert(&open, r->label, (void*)(ptrdiff_t)(i + 1));
+            continue;
+        }
+        if (!current) continue;
+
+        long loanAt = (ptrdiff_t)current - 1;
+        LoanRecord* loan = records[loanAt];
+        if (strcmp(loan->studentID, r->studentID) != 0 || r->day >= cutoffDay ||
+            loan->day == INVALID_DAY || r->day == INVALID_DAY) continue;
+
+        move[loanAt] = move[i] = 1;
+        strcpy(loans[archived].studentID, loan->studentID);
+        strcpy(loans[archived].label, loan->label);
+        loans[archived].loanDay = loan->day;
+        loans[archived].returnDay = r->day;
+        archived++;
+    }
+    free(open.slots);
+
+    long archiveSize;
+    if (archived > 0 && !appendArchiveBlock(loans, archived, &archiveSize)) archived = -1;
+    if (archived > 0) {
+        LoanRecord* head = NULL;
+        LoanRecord* tail = NULL;
+        for (i = 0; i < n; i++) {
+            if (move[i]) continue;
+            if (!head) head = records[i];
+            else tail->next = records[i];
+            tail = records[i];
+        }
+        if (tail) tail->next = NULL;
+        if (writeLoansToFile(head)) {
+            for (i = 0; i < n; i++) {
+                if (move[i]) poolFree(&loanPool, records[i]);
+            }
+            *loanList = head;
+            loanTail = tail;
+            loanTableRebuild(head);
+        } else {
+            // LoanRecords.csv still has the moved loans: relink them and
+            // take the block back out of the archive
+            for (i = 0; i < n; i++) records[i]->next = i + 1 < n ? records[i + 1] : NULL;
+            undoArchiveAppend(archiveSize);
+            archived = -1;
+        }
+    }
+
+    free(records);
+    free(move);
+    free(loans);
+    return archived;
+}
+
+// Decodes LoanArchive.bin and calls visit for every archived loan. Returns
+// 0 if the file is missing or damaged (loans before the damage are visited).
+int readLoanArchive(void (*visit)(const ArchivedLoan*, void*), void* context) {
+    size_t size = 0;
+    char* data = mapFile(ARCHIVE_FILE, &size);
+    if (!data) return 0;
+
+    ArchiveHeader header;
+    int ok = size >= sizeof(header);
+    if (ok) {
+        memcpy(&header, data, sizeof(header));
+        ok = memcmp(header.magic, "LIBARCH", 8) == 0 && header.version == ARCHIVE_VERSION;
+    }
+
+    const unsigned char* in = (const unsigned char*)data + sizeof(header);
+    const unsigned char* end = (const unsigned char*)data + size;
+    while (ok && in < end) {
+        unsigned long long count, length, i;
+        ok = getVarint(&in, end, &count) && getVarint(&in, end, &length) && length <= (unsigned long long)(end - in);
+        if (!ok) break;
+
+        const unsigned char* blockEnd = in + length;
+        long long day = 0;
+        for (i = 0; ok && i < count; i++) {
+            ArchivedLoan loan;
+            unsigned long long flags, a, b;
+            ok = getVarint(&in, blockEnd, &flags);
+            if (ok && (flags & 1)) ok = getText(&in, blockEnd, loan.studentID, sizeof(loan.studentID));
+            else if (ok) ok = getVarint(&in, blockEnd, &a) && a <= 99999999ULL &&
+                              snprintf(loan.studentID, sizeof(loan.studentID), "%llu", a) > 0;
+            if (ok && (flags & 2)) ok = getText(&in, blockEnd, loan.label, sizeof(loan.label));
+            else if (ok) ok = getVarint(&in, blockEnd, &a) && getVarint(&in, blockEnd, &b) &&
+                              snprintf(loan.label, sizeof(loan.label), "%llu_%llu", a, b) < (int)sizeof(loan.label);
+            if (ok) ok = getVarint(&in, blockEnd, &a) && getVarint(&in, blockEnd, &b);
+            if (!ok) break;
+            day += unzigzag(a);
+            loan.loanDay = (int)day;
+            loan.returnDay = (int)(day + unzigzag(b));
+            visit(&loan, context);
+        }
+        in = blockEnd;
+    }
+
+    unmapFile(data, size);
+    return ok;
+}
+
+typedef struct {
+    const char* studentID;
+    long found;
+    long read;
+} ArchiveQuery;
+
+void printArchivedLoan(const ArchivedLoan* loan, void* context) {
+    ArchiveQuery* query = context;
+    query->read++;
+    if (strcmp(loan->studentID, query->studentID) != 0) return;
+    char borrowed[11], returned[11];
+    formatDate(loan->loanDay, borrowed);
+    formatDate(loan->returnDay, returned);
+    fprintf(OUT, "- %s borrowed %s, returned %s\n", loan->label, borrowed, returned);
+    query->found++;
+}
+
+void showArchivedLoans(const char* studentID) {
+    double start = wallClock();
+    ArchiveQuery query = {studentID, 0, 0};
+    fprintf(OUT, "Archived loans of %s:\n", studentID);
+    int ok = readLoanArchive(printArchivedLoan, &query);
+    if (query.found == 0) fprintf(OUT, "None\n");
+    FILE* f = fopen(ARCHIVE_FILE, "rb");
+    if (f) {
+        fclose(f);
+        if (!ok) fprintf(OUT, "%s is damaged; only part of it could be read.\n", ARCHIVE_FILE);
+    }
+    recordMetric(METRIC_ARCHIVED, start, 0, query.read);
+}
+
+// =================== Snapshot Functions ===================
+
+// Library.snap is a binary image of everything the CSV files hold. It is
+// written on exit and adopted at startup without any text parsing, as long
+// as none of the CSV files changed since it was written; otherwise the
+// CSVs are loaded as before. The CSVs stay the primary format.
+#define SNAPSHOT_FILE "Library.snap"
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_SOURCES 5
+
+static const char* snapshotSources[SNAPSHOT_SOURCES] = {
+    "Yazarlar.csv", "Ogrenciler.csv", "Kitaplar.csv", "LoanRecords.csv", "KitapYazar.csv"
+};
+
+enum { SNAP_AUTHORS, SNAP_STUDENTS, SNAP_BOOKS, SNAP_COPIES, SNAP_LOANS, SNAP_MAPPINGS, SNAP_SECTIONS };
+
+typedef struct {
+    long long size;    // -1 if the file did not exist
+    long long mtime;
+    long long mtimeNsec;
+} SnapshotSource;
+
+typedef struct {
+    char magic[8];
+    unsigned int version;
+    unsigned int recordSizes[SNAP_SECTIONS];
+    unsigned int counts[SNAP_SECTIONS];
+    SnapshotSource sources[SNAPSHOT_SOURCES];
+} SnapshotHeader;
+
+typedef struct { int id; char firstName[50]; char lastName[50]; } SnapAuthor;
+typedef struct { char id[9]; char firstName[50]; char lastName[50]; int points; } SnapStudent;
+typedef struct { char title[100]; char isbn[14]; int quantity; int copyCount; long long copiesOffset; } SnapBook;
+typedef struct { int number; int dirty; char status[20]; } SnapCopy;
+typedef struct { char studentID[9]; char label[30]; int type; int day; } SnapLoan;
+typedef struct { char isbn[14]; int authorID; } SnapMapping;
+
+static const unsigned int snapRecordSizes[SNAP_SECTIONS] = {
+    sizeof(SnapAuthor), sizeof(SnapStudent), sizeof(SnapBook),
+    sizeof(SnapCopy), sizeof(SnapLoan), sizeof(SnapMapping)
+};
+
+void statSource(const char* path, SnapshotSource* src) {
+    struct stat st;
+    memset(src, 0, sizeof(*src));
+    if (stat(path, &st) != 0) {
+        src->size = -1;
+        return;
+    }
+    src->size = st.st_size;
+    src->mtime = st.st_mtime;
+#if defined(__linux__)
+    src->mtimeNsec = st.st_mtim.tv_nsec;
+#endif
+}
+
+// Maps a whole file read-only; falls back to reading it into memory.
+char* mapFile(const char* path, size_t* size) {
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    *size = st.st_size;
+    return data;
+#else
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = length > 0 ? malloc(length) : NULL;
+    if (data && fread(data, 1, length, f) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = length;
+    return data;
+#endif
+}
+
+void unmapFile(char* data, size_t size) {
+#ifndef _WIN32
+    munmap(data, size);
+#else
+    free(data);
+#endif
+}
+
+// Writes the snapshot to a temporary file and renames it into place, so a
+// crash never leaves a half-written Library.snap behind.
+void writeSnapshot(const Library* lib) {
+    double start = wallClock();
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "LIBSNAP", 8);
+    header.version = SNAPSHOT_VERSION;
+    memcpy(header.recordSizes, snapRecordSizes, sizeof(snapRecordSizes));
+
+    Author* a;
+    Student* s;
+    Book* b;
+    BookCopy* c;
+    LoanRecord* l;
+    for (a = lib->authors; a; a = a->next) header.counts[SNAP_AUTHORS]++;
+    for (s = lib->students; s; s = s->next) header.counts[SNAP_STUDENTS]++;
+    for (b = lib->books; b; b = b->next) {
+        header.counts[SNAP_BOOKS]++;
+        header.counts[SNAP_COPIES] += b->copyCount;
+    }
+    for (l = lib->loans; l; l = l->next) header.counts[SNAP_LOANS]++;
+    header.counts[SNAP_MAPPINGS] = lib->manager.count;
+
+    int i;
+    for (i = 0; i < SNAPSHOT_SOURCES; i++) statSource(snapshotSources[i], &header.sources[i]);
+
+    FILE* f = openReplacement(SNAPSHOT_FILE, "wb");
+    if (!f) return;
+    fwrite(&header, sizeof(header), 1, f);
+
+    SnapAuthor sa;
+    SnapStudent ss;
+    SnapBook sb;
+    SnapCopy sc;
+    SnapLoan sl;
+    for (a = lib->authors; a; a = a->next) {
+        memset(&sa, 0, sizeof(sa));
+        sa.id = a->id;
+        strcpy(sa.firstName, a->firstName);
+        strcpy(sa.lastName, a->lastName);
+        fwrite(&sa, sizeof(sa), 1, f);
+    }
+    for (s = lib->students; s; s = s->next) {
+        memset(&ss, 0, sizeof(ss));
+        strcpy(ss.id, s->id);
+        strcpy(ss.firstName, s->firstName);
+        strcpy(ss.lastName, s->lastName);
+        ss.points = s->points;
+        fwrite(&ss, sizeof(ss), 1, f);
+    }
+    for (b = lib->books; b; b = b->next) {
+        memset(&sb, 0, sizeof(sb));
+        strcpy(sb.title, b->title);
+        strcpy(sb.isbn, b->isbn);
+        sb.quantity = b->quantity;
+        sb.copyCount = b->copyCount;
+        sb.copiesOffset = b->copiesOffset;
+        fwrite(&sb, sizeof(sb), 1, f);
+    }
+    for (b = lib->books; b; b = b->next) {
+        for (c = b->copies; c < b->copies + b->copyCount; c++) {
+            memset(&sc, 0, sizeof(sc));
+            sc.number = c->number;
+            sc.dirty = c->dirty;
+            strcpy(sc.status, copyStatus(c));
+            fwrite(&sc, sizeof(sc), 1, f);
+        }
+    }
+    for (l = lib->loans; l; l = l->next) {
+        memset(&sl, 0, sizeof(sl));
+        strcpy(sl.studentID, l->studentID);
+        strcpy(sl.label, l->label);
+        sl.type = l->type;
+        sl.day = l->day;
+        fwrite(&sl, sizeof(sl), 1, f);
+    }
+    SnapMapping sm;
+    BookAuthor* m;
+    for (m = lib->manager.first; m; m = m->next) {
+        memset(&sm, 0, sizeof(sm));
+        strcpy(sm.isbn, m->isbn);
+        sm.authorID = m->authorID;
+        fwrite(&sm, sizeof(sm), 1, f);
+    }
+
+    long bytes = ftell(f);
+    commitReplacement(f, SNAPSHOT_FILE);
+    long long records = 0;
+    for (i = 0; i < SNAP_SECTIONS; i++) records += header.counts[i];
+    recordMetric(METRIC_WRITE_SNAPSHOT, start, bytes, records);
+}
+
+// Records are copied out with memcpy: sections are packed back to back, so
+// a record inside the mapping is not necessarily aligned for direct access.
+#define SNAP_NEXT(dst, cursor) (memcpy(&(dst), (cursor), sizeof(dst)), (cursor) += sizeof(dst))
+
+#define SNAP_TERMINATED(field) (memchr((field), '\0', sizeof(field)) != NULL)
+
+// Checks the records before anything is built from them: every string
+// field ends inside its record, and the books' copy counts add up to the
+// copies section. A damaged file then falls back to the CSVs instead of
+// reading past the mapping.
+int snapshotIntact(const char* cursor, const SnapshotHeader* header) {
+    unsigned int n;
+    unsigned long long copies = 0;
+    SnapAuthor sa;
+    SnapStudent ss;
+    SnapBook sb;
+    SnapCopy sc;
+    SnapLoan sl;
+    SnapMapping sm;
+
+    for (n = 0; n < header->counts[SNAP_AUTHORS]; n++) {
+        SNAP_NEXT(sa, cursor);
+        if (!SNAP_TERMINATED(sa.firstName) || !SNAP_TERMINATED(sa.lastName)) return 0;
+    }
+    for (n = 0; n < header->counts[SNAP_STUDENTS]; n++) {
+        SNAP_NEXT(ss, cursor);
+        if (!SNAP_TERMINATED(ss.id) || !SNAP_TERMINATED(ss.firstName) || !SNAP_TERMINATED(ss.lastName)) return 0;
+    }
+    for (n = 0; n < header->counts[SNAP_BOOKS]; n++) {
+        SNAP_NEXT(sb, cursor);
+        if (!SNAP_TERMINATED(sb.title) || !SNAP_TERMINATED(sb.isbn) || sb.copyCount < 0) return 0;
+        copies += sb.copyCount;
+    }
+    if (copies != header->counts[SNAP_COPIES]) return 0;
+    for (n = 0; n < header->counts[SNAP_COPIES]; n++) {
+        SNAP_NEXT(sc, cursor);
+        if (!SNAP_TERMINATED(sc.status)) return 0;
+    }
+    for (n = 0; n < header->counts[SNAP_LOANS]; n++) {
+        SNAP_NEXT(sl, cursor);
+        if (!SNAP_TERMINATED(sl.studentID) || !SNAP_TERMINATED(sl.label)) return 0;
+    }
+    for (n = 0; n < header->counts[SNAP_MAPPINGS]; n++) {
+        SNAP_NEXT(sm, cursor);
+        if (!SNAP_TERMINATED(sm.isbn)) return 0;
+    }
+    return 1;
+}
+
+// Adopts Library.snap if it is present, well formed and newer than every
+// CSV file. Returns 0 (and leaves lib untouched) otherwise.
+int loadSnapshot(Library* lib) {
+    double start = wallClock();
+    size_t size = 0;
+    char* data = mapFile(SNAPSHOT_FILE, &size);
+    if (!data) return 0;
+
+    SnapshotHeader header;
+    int i, fresh = size >= sizeof(header);
+    if (fresh) {
+        memcpy(&header, data, sizeof(header));
+        fresh = memcmp(header.magic, "LIBSNAP", 8) == 0 && header.version == SNAPSHOT_VERSION &&
+                memcmp(header.recordSizes, snapRecordSizes, sizeof(snapRecordSizes)) == 0;
+    }
+    if (fresh) {
+        size_t expected = sizeof(header);
+        for (i = 0; i < SNAP_SECTIONS; i++) expected += (size_t)header.counts[i] * snapRecordSizes[i];
+        fresh = expected == size;
+    }
+    for (i = 0; fresh && i < SNAPSHOT_SOURCES; i++) {
+        SnapshotSource now;
+        statSource(snapshotSources[i], &now);
+        fresh = memcmp(&now, &header.sources[i], sizeof(now)) == 0;
+    }
+    if (fresh) fresh = snapshotIntact(data + sizeof(header), &header);
+    if (!fresh) {
+        unmapFile(data, size);
+        return 0;
+    }
+
+    const char* cursor = data + sizeof(header);
+    unsigned int n;
+    SnapAuthor sa;
+    SnapStudent ss;
+    SnapBook sb;
+    SnapCopy sc;
+    SnapLoan sl;
+
+    Author* authorTail = NULL;
+    for (n = 0; n < header.counts[SNAP_AUTHORS]; n++) {
+        SNAP_NEXT(sa, cursor);
+        Author* a = poolAlloc(&authorPool);
+        a->id = sa.id;
+        strcpy(a->firstName, sa.firstName);
+        strcpy(a->lastName, sa.lastName);
+        a->next = NULL;
+        indexAuthor(a);
+        if (authorTail) authorTail->next = a;
+        else lib->authors = a;
+        authorTail = a;
+    }
+
+    Student* studentTail = NULL;
+    for (n = 0; n < header.counts[SNAP_STUDENTS]; n++) {
+        SNAP_NEXT(ss, cursor);
+        Student* s = poolAlloc(&studentPool);
+        strcpy(s->id, ss.id);
+        strcpy(s->firstName, ss.firstName);
+        strcpy(s->lastName, ss.lastName);
+        s->points = ss.points;
+        s->holder = internHolder(s->id);
+        s->next = NULL;
+        s->prev = studentTail;
+        indexInsert(&studentIndex, s->id, s);
+        if (studentTail) studentTail->next = s;
+        else lib->students = s;
+        studentTail = s;
+    }
+    lastStudent = studentTail;
+
+    // Copies are stored after all books, in book order
+    const char* copyCursor = cursor + (size_t)header.counts[SNAP_BOOKS] * sizeof(SnapBook);
+    Book* bookTail = NULL;
+    for (n = 0; n < header.counts[SNAP_BOOKS]; n++) {
+        SNAP_NEXT(sb, cursor);
+        Book* b = poolAlloc(&bookPool);
+        strcpy(b->title, sb.title);
+        strcpy(b->isbn, sb.isbn);
+        b->quantity = sb.quantity;
+        b->copies = sb.copyCount > 0 ? malloc(sb.copyCount * sizeof(BookCopy)) : NULL;
+        b->copyCount = b->copies ? sb.copyCount : 0;
+        b->copiesOffset = (long)sb.copiesOffset;
+        b->onShelf = NULL;
+        b->next = NULL;
+
+        int k;
+        for (k = 0; k < sb.copyCount; k++) {
+            SNAP_NEXT(sc, copyCursor);
+            if (!b->copies) continue;
+            BookCopy* c = &b->copies[k];
+            c->number = sc.number;
+            c->holder = internHolder(sc.status);
+            c->dirty = 0;
+            // Not in Kitaplar.csv yet: write it with the next save
+            if (sc.dirty) markCopyDirty(b, c);
+        }
+        buildShelfBitmap(b);
+        indexInsert(&bookIndex, b->isbn, b);
+        titleIndexAdd(b);
+        if (bookTail) bookTail->next = b;
+        else lib->books = b;
+        bookTail = b;
     }
+    lastBook = bookTail;
+    cursor = copyCursor;
+
+    LoanRecord* loanListTail = NULL;
+    for (n = 0; n < header.counts[SNAP_LOANS]; n++) {
+        SNAP_NEXT(sl, cursor);
+        LoanRecord* l = poolAlloc(&loanPool);
+        strcpy(l->studentID, sl.studentID);
+        strcpy(l->label, sl.label);
+        l->type = sl.type;
+        l->day = sl.day;
+        l->next = NULL;
+        trackOpenLoan(l);
+        loanTableAppend(l);
+        if (loanListTail) loanListTail->next = l;
+        else lib->loans = l;
+        loanListTail = l;
+    }
+    loanTail = loanListTail;
+    journalTail = loanListTail;
 
-    while (head) {
-        fprintf(file, "%s,%s,%s,%d\n", head->id, head->firstName, head->lastName, head->points);
-        head = head->next;
+    SnapMapping sm;
+    for (n = 0; n < header.counts[SNAP_MAPPINGS]; n++) {
+        SNAP_NEXT(sm, cursor);
+        addBookAuthorMapping(&lib->manager, sm.isbn, sm.authorID);
     }
 
-    fclose(file);
+    unmapFile(data, size);
+    long long records = 0;
+    for (i = 0; i < SNAP_SECTIONS; i++) records += header.counts[i];
+    recordMetric(METRIC_LOAD_SNAPSHOT, start, 0, records);
+    return 1;
 }
 
+// Startup: the snapshot when it is current, the CSV files otherwise.
+void loadLibrary(Library* lib) {
+    memset(lib, 0, sizeof(*lib));
+    if (loadSnapshot(lib)) return;
 
-Student* readStudentsFromFile() {
-    FILE* file = fopen("Ogrenciler.csv", "r");
-    if (!file) return NULL;
+    lib->authors = readAuthorsFromFile();
+    lib->students = readStudentsFromFile();
+    lib->books = readBooksFromFile();
+    lib->loans = readLoansFromFile();
+    readBookAuthorCSV(&lib->manager);
+}
 
-    char line[200];
-    Student* head = NULL;
-    Student* tail = NULL;
+void showStudentMenu(StudentOperation* ops, int opCount, Student** list, LoanRecord** loanList, Book* bookList) {
+    int choice;
+    while (1) {
+        printf("\n--- STUDENT OPERATIONS ---\n");
+        int i;
+		for (i = 0; i < opCount; ++i)
+            printf("%d. %s\n", ops[i].option, ops[i].label);
+        printf("0. Back\nChoice: ");
+        scanf("%d", &choice);
+        getchar();
 
-    while (fgets(line, sizeof(line), file)) {
-        Student* s = malloc(sizeof(Student));
-        sscanf(line, "%8[^,],%49[^,],%49[^,],%d", s->id, s->firstName, s->lastName, &s->points);
-        s->next = NULL;
-        s->prev = NULL;
+        if (choice == 0) break;
 
-        if (!head) head = tail = s;
-        else {
-            tail->next = s;
-            s->prev = tail;
-            tail = s;
+        int found = 0;
+        for ( i = 0; i < opCount; ++i) {
+            if (ops[i].option == choice) {
+                ops[i].func(list, loanList, bookList);
+                found = 1;
+                break;
+            }
         }
+        if (!found) printf("Invalid choice.\n");
     }
-
-    fclose(file);
-    return head;
 }
 
-int deleteStudent(Student** head, const char* id) {
-    Student* current = *head;
-    while (current) {
-        if (strcmp(current->id, id) == 0) {
-            if (current->prev) current->prev->next = current->next;
-            else *head = current->next;
 
-            if (current->next) current->next->prev = current->prev;
+//author void menu before main
 
-            free(current);
-            return 1;  // success
-        }
-        current = current->next;
-    }
-    return 0;  // not found
-}
+void showAuthorMenu(AuthorOperation* ops, int opCount, Author** list, BookAuthorManager* manager, Book* bookList) {
+    int choice;
+    while (1) {
+        printf("\n--- AUTHOR OPERATIONS ---\n");
+        int i;
+		for (i = 0; i < opCount; ++i)
+            printf("%d. %s\n", ops[i].option, ops[i].label);
+        printf("0. Back\nChoice: ");
+        scanf("%d", &choice);
+        getchar();
 
-int updateStudent(Student* head, const char* id, const char* newFirst, const char* newLast) {
-    while (head) {
-        if (strcmp(head->id, id) == 0) {
-            strcpy(head->firstName, newFirst);
-            strcpy(head->lastName, newLast);
-            return 1;
-        }
-        head = head->next;
-    }
-    return 0;
-}
+        if (choice == 0) break;
 
-void showStudentInfo(Student* head, LoanRecord* loans, const char* id) {
-    while (head) {
-        if (strcmp(head->id, id) == 0) {
-            printf("\nStudent Info:\n");
-            printf("ID: %s\nName: %s %s\nPoints: %d\n", head->id, head->firstName, head->lastName, head->points);
-            printf("Loan History:\n");
-
-            while (loans) {
-                if (strcmp(loans->studentID, id) == 0) {
-                    printf("- %s [%s] on %s\n", loans->label, loans->type == 0 ? "LOAN" : "RETURN", loans->date);
-                }
-                loans = loans->next;
-            }
-            return;
-        }
-        head = head->next;
-    }
-    printf("Student not found.\n");
-}
+        int found = 0;
+        for (i = 0; i < opCount; ++i) {
+            if (ops[i].option == choice) {
+              ops[i].func(list, manager, bookList);
 
-void listStudentsWithUnreturnedBooks(Student* students, LoanRecord* loans) {
-    printf("\n--- Student that havent return books ---\n");
-    Student* s;
-    for (s = students; s != NULL; s = s->next) {
-        int hasUnreturned = 0;
-        LoanRecord* l;
-        for (l = loans; l != NULL; l = l->next) {
-            if (l->type == 0 && strcmp(l->studentID, s->id) == 0) {
-                // search for matching return
-                LoanRecord* r;
-                int returned = 0;
-                for (r = loans; r != NULL; r = r->next) {
-                    if (r->type == 1 &&
-                        strcmp(r->studentID, s->id) == 0 &&
-                        strcmp(r->label, l->label) == 0) {
-                        returned = 1;
-                        break;
-                    }
-                }
-                if (!returned) {
-                    hasUnreturned = 1;
-                    break;
-                }
+                found = 1;
+                break;
             }
         }
-        if (hasUnreturned) {
-            printf("ID: %s | %s %s\n", s->id, s->firstName, s->lastName);
-        }
+
+        if (!found)
+            printf("Invalid choice.\n");
     }
 }
 
+//book show menu void 
 
-void listPenalizedStudents(Student* students, LoanRecord* loans) {
-    printf("\n--- Penalized Students ---\n");
+void showBookMenu(BookOperation* ops, int opCount, Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
+    int choice;
+    while (1) {
+        printf("\n--- BOOK OPERATIONS ---\n");
+        int i;
+		for ( i = 0; i < opCount; ++i)
+            printf("%d. %s\n", ops[i].option, ops[i].label);
+        printf("0. Back\nChoice: ");
+        scanf("%d", &choice);
+        getchar();
 
-    LoanRecord* l;
-    for (l = loans; l != NULL; l = l->next) {
-        if (l->type == 1) { // return
-            LoanRecord* loan = NULL;
-            LoanRecord* k = loans;
-            while (k) {
-                if (k->type == 0 &&
-                    strcmp(k->studentID, l->studentID) == 0 &&
-                    strcmp(k->label, l->label) == 0) {
-                    loan = k;
-                    break;
-                }
-                k = k->next;
-            }
+        if (choice == 0) break;
 
-            if (loan) {
-                int delay = daysBetween(loan->date, l->date);
-                if (delay > 15) {
-                    Student* s = students;
-                    while (s) {
-                        if (strcmp(s->id, l->studentID) == 0) {
-                            printf("ID: %s | %s %s | Late Return: %d day\n",
-                                   s->id, s->firstName, s->lastName, delay);
-                            break;
-                        }
-                        s = s->next;
-                    }
-                }
+        int found = 0;
+		for (i = 0; i < opCount; ++i) {
+            if (ops[i].option == choice) {
+                ops[i].func(bookList, loanList, authorList, manager);
+                found = 1;
+                break;
             }
         }
+        if (!found) printf("Invalid choice.\n");
     }
 }
 
 
+// =================== Report Export ===================
+// Any report can be streamed to a file (or to the output, with "-") as CSV
+// or JSON Lines. Rows are formatted by hand into one large buffer that is
+// written whenever it fills up, so a million-row report costs a handful of
+// sequential writes instead of a printf per row. offset/limit select a
+// page of rows; the scans stop as soon as the page is complete.
 
+#define EXPORT_BUFFER_SIZE (1 << 20)
 
-void listAllStudents(Student* head) {
-    printf("\n--- All Students ---\n");
-    while (head) {
-        printf("ID: %s | Name: %s %s | Points: %d\n", head->id, head->firstName, head->lastName, head->points);
-        head = head->next;
-    }
+typedef enum { EXPORT_CSV, EXPORT_JSONL } ExportFormat;
+
+typedef struct {
+    FILE* out;
+    ExportFormat format;
+    const char* const* columns; // NULL-terminated, also the JSON keys
+    int field;                  // fields written in the current row
+    long offset;                // rows to skip
+    long limit;                 // rows to write, -1 = all
+    long seen;                  // rows offered so far
+    long written;
+    int failed;
+    char* buffer;
+    size_t used;
+    long long flushed;          // bytes handed to the file so far
+} Exporter;
+
+void exportFlush(Exporter* e) {
+    if (e->used > 0 && fwrite(e->buffer, 1, e->used, e->out) != e->used) e->failed = 1;
+    e->flushed += e->used;
+    e->used = 0;
 }
 
+// Room for n more bytes at the end of the buffer.
+char* exportReserve(Exporter* e, size_t n) {
+    if (e->used + n > EXPORT_BUFFER_SIZE) exportFlush(e);
+    return e->buffer + e->used;
+}
 
+// The page is complete; report scans stop here.
+int exportDone(const Exporter* e) {
+    return e->limit >= 0 && e->written >= e->limit;
+}
 
-// book operation functions 
+// Starts the next row. Returns 0 if the row falls outside the page.
+int exportBeginRow(Exporter* e) {
+    if (e->seen++ < e->offset || exportDone(e)) return 0;
+    e->field = 0;
+    return 1;
+}
 
-void op_addBook(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
-    char title[100], isbn[14];
-    int quantity;
-    printf("Enter book title: ");
-    scanf(" %[^\n]", title);
-    printf("Enter ISBN: ");
-    scanf("%s", isbn);
-    if (bookExists(*bookList, isbn)) {
-        printf("Book already exists.\n");
-        return;
-    }
-    printf("Enter quantity: ");
-    scanf("%d", &quantity);
-    *bookList = addBook(*bookList, title, isbn, quantity);
-    writeBooksToFile(*bookList);
-    printf("Book added.\n");
+void exportEndRow(Exporter* e) {
+    char* p = exportReserve(e, 2);
+    if (e->format == EXPORT_JSONL) *p++ = '}';
+    *p++ = '\n';
+    e->used = p - e->buffer;
+    e->written++;
 }
 
-void op_deleteBook(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
-    char isbn[14];
-    printf("Enter ISBN to delete: ");
-    scanf("%s", isbn);
-    *bookList = deleteBookByISBN(*bookList, isbn);
-    writeBooksToFile(*bookList);
-    printf("Book deleted.\n");
+// Writes the separator (and the key, in JSON) for the next field.
+char* exportFieldStart(Exporter* e, size_t valueSize) {
+    const char* key = e->columns[e->field];
+    char* p = exportReserve(e, strlen(key) + valueSize + 4);
+    if (e->format == EXPORT_CSV) {
+        if (e->field > 0) *p++ = ',';
+    } else {
+        *p++ = e->field > 0 ? ',' : '{';
+        *p++ = '"';
+        while (*key) *p++ = *key++;
+        *p++ = '"';
+        *p++ = ':';
+    }
+    e->field++;
+    return p;
 }
-void op_updateBook(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
-    char isbn[14], newTitle[100];
-    printf("Enter ISBN to update: ");
-    scanf("%s", isbn);
-    printf("New Title: ");
-    scanf(" %[^\n]", newTitle);
-    if (updateBookTitle(*bookList, isbn, newTitle)) {
-        writeBooksToFile(*bookList);
-        printf("Book title updated.\n");
+
+void exportText(Exporter* e, const char* text) {
+    static const char hex[] = "0123456789abcdef";
+    size_t len = strlen(text);
+    char* p = exportFieldStart(e, len * 6 + 2); // every byte escaped, plus quotes
+    const unsigned char* s;
+    if (e->format == EXPORT_CSV) {
+        int quote = strpbrk(text, ",\"\r\n") != NULL;
+        if (quote) *p++ = '"';
+        for (s = (const unsigned char*)text; *s; s++) {
+            if (*s == '"') *p++ = '"';
+            *p++ = *s;
+        }
+        if (quote) *p++ = '"';
     } else {
-        printf("Book not found.\n");
+        *p++ = '"';
+        for (s = (const unsigned char*)text; *s; s++) {
+            if (*s == '"' || *s == '\\') {
+                *p++ = '\\';
+                *p++ = *s;
+            } else if (*s < 0x20) {
+                memcpy(p, "\\u00", 4);
+                p[4] = hex[*s >> 4];
+                p[5] = hex[*s & 15];
+                p += 6;
+            } else {
+                *p++ = *s;
+            }
+        }
+        *p++ = '"';
     }
+    e->used = p - e->buffer;
 }
-void op_viewBookByTitle(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
-    char title[100];
-    printf("Enter title to search: ");
-    scanf(" %[^\n]", title);
-    showBookInfoByTitle(*bookList, title);
+
+void exportInt(Exporter* e, long value) {
+    char digits[24];
+    int n = 0;
+    unsigned long v = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    char* p = exportFieldStart(e, n + 1);
+    if (value < 0) *p++ = '-';
+    while (n > 0) *p++ = digits[--n];
+    e->used = p - e->buffer;
 }
-void op_listBooksOnShelf(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
-    listBooksOnShelf(*bookList);
+
+void exportDate(Exporter* e, int day) {
+    char date[11];
+    formatDate(day, date);
+    exportText(e, date);
 }
-void op_listAllBooks(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
-    Book* b;
-    BookCopy* c;
-    for (b = *bookList; b != NULL; b = b->next) {
-        printf("Book: %s, ISBN: %s, Qty: %d\n", b->title, b->isbn, b->quantity);
-        showAuthorsForBook(b->isbn, authorList, manager);
-        for (c = b->copies; c != NULL; c = c->next) {
-            printf("   Copy: %s, Status: %s\n", c->label, c->status);
-        }
+
+void exportStudents(Library* lib, Exporter* e) {
+    Student* s;
+    for (s = lib->students; s && !exportDone(e); s = s->next) {
+        if (!exportBeginRow(e)) continue;
+        exportText(e, s->id);
+        exportText(e, s->firstName);
+        exportText(e, s->lastName);
+        exportInt(e, s->points);
+        exportEndRow(e);
     }
 }
-void op_listOverdueBooks(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
-    listOverdueBooks(*loanList);
-}
-void op_addBookAuthorMapping(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
-    char isbn[14];
-    int authorID;
 
-    printf("Enter Book ISBN: ");
-    scanf("%s", isbn);
-    printf("Enter Author ID: ");
-    scanf("%d", &authorID);
+void exportAuthors(Library* lib, Exporter* e) {
+    Author* a;
+    for (a = lib->authors; a && !exportDone(e); a = a->next) {
+        if (!exportBeginRow(e)) continue;
+        exportInt(e, a->id);
+        exportText(e, a->firstName);
+        exportText(e, a->lastName);
+        exportEndRow(e);
+    }
+}
 
-    addBookAuthorMapping(manager, isbn, authorID);
-    writeBookAuthorCSV(manager);
-    printf("Mapping added: Book %s  Author %d\n", isbn, authorID);
+void exportBooks(Library* lib, Exporter* e) {
+    Book* b;
+    for (b = lib->books; b && !exportDone(e); b = b->next) {
+        if (!exportBeginRow(e)) continue;
+        exportText(e, b->isbn);
+        exportText(e, b->title);
+        exportInt(e, b->quantity);
+        exportInt(e, b->onShelfCount);
+        exportEndRow(e);
+    }
 }
-void op_updateBookAuthors(Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
-    char isbn[14];
-    printf("Enter Book ISBN to update authors: ");
-    scanf("%s", isbn);
-    updateBookAuthors(manager, isbn);
+
+void exportCopies(Library* lib, Exporter* e) {
+    Book* b;
+    BookCopy* c;
+    char label[30];
+    for (b = lib->books; b && !exportDone(e); b = b->next) {
+        for (c = b->copies; c < b->copies + b->copyCount; c++) {
+            if (!exportBeginRow(e)) continue;
+            exportText(e, copyLabel(b, c, label));
+            exportText(e, b->isbn);
+            exportText(e, copyStatus(c));
+            exportEndRow(e);
+        }
+    }
 }
 
+void exportLoans(Library* lib, Exporter* e) {
+    LoanRecord* l;
+    for (l = lib->loans; l && !exportDone(e); l = l->next) {
+        if (!exportBeginRow(e)) continue;
+        exportText(e, l->studentID);
+        exportText(e, l->label);
+        exportText(e, l->type == 0 ? "LOAN" : "RETURN");
+        exportDate(e, l->day);
+        exportEndRow(e);
+    }
+}
 
-// =================== Book Functions ===================
-BookCopy* createBookCopies(char* isbn, int quantity) {
-    BookCopy* head = NULL;
-    BookCopy* tail = NULL;
+void exportUnreturned(Library* lib, Exporter* e) {
+    StringIndex listed = {NULL, 0, 0, 0};
     int i;
-    for (i = 1; i <= quantity; i++) {
-        BookCopy* copy = malloc(sizeof(BookCopy));
-        sprintf(copy->label, "%s_%d", isbn, i);
-        strcpy(copy->status, "RAFTA");
-        copy->next = NULL;
+    for (i = 0; i < openLoanCount && !exportDone(e); i++) {
+        Student* s = findStudent(openLoans[i]->studentID);
+        if (!s || indexFind(&listed, s->id)) continue;
+        indexInsert(&listed, s->id, s);
+        if (!exportBeginRow(e)) continue;
+        exportText(e, s->id);
+        exportText(e, s->firstName);
+        exportText(e, s->lastName);
+        exportEndRow(e);
+    }
+    free(listed.slots);
+}
 
-        if (!head) head = tail = copy;
-        else {
-            tail->next = copy;
-            tail = copy;
-        }
+int exportOverdueLoan(const OverdueLoan* overdue, void* context) {
+    Exporter* e = context;
+    if (exportBeginRow(e)) {
+        exportText(e, overdue->loan->label);
+        exportText(e, overdue->loan->studentID);
+        exportDate(e, overdue->loan->day);
+        exportInt(e, overdue->days);
+        exportInt(e, overdue->returned);
+        exportEndRow(e);
     }
-    return head;
+    return !exportDone(e);
 }
 
-Book* addBook(Book* head, char* title, char* isbn, int quantity) {
-    Book* newBook = malloc(sizeof(Book));
-    strcpy(newBook->title, title);
-    strcpy(newBook->isbn, isbn);
-    newBook->quantity = quantity;
-    newBook->copies = createBookCopies(isbn, quantity);
-    newBook->next = NULL;
+void exportOverdue(Library* lib, Exporter* e) {
+    scanOverdueLoans(exportOverdueLoan, e);
+}
 
-    if (!head) return newBook;
+int exportLateReturn(const LateReturn* late, void* context) {
+    Exporter* e = context;
+    if (exportBeginRow(e)) {
+        exportText(e, late->student->id);
+        exportText(e, late->student->firstName);
+        exportText(e, late->student->lastName);
+        exportInt(e, late->delay);
+        exportEndRow(e);
+    }
+    return !exportDone(e);
+}
 
-    Book* tail = head;
-    while (tail->next) tail = tail->next;
-    tail->next = newBook;
-    return head;
+void exportPenalized(Library* lib, Exporter* e) {
+    scanLateReturns(exportLateReturn, e);
 }
 
-Book* deleteBookByISBN(Book* head, const char* isbn) {
-    Book* curr = head;
-    Book* prev = NULL;
+typedef struct {
+    const char* name;
+    const char* columns[6];
+    void (*rows)(Library*, Exporter*);
+} ExportReport;
+
+ExportReport exportReports[] = {
+    {"students", {"id", "firstName", "lastName", "points", NULL}, exportStudents},
+    {"authors", {"id", "firstName", "lastName", NULL}, exportAuthors},
+    {"books", {"isbn", "title", "quantity", "onShelf", NULL}, exportBooks},
+    {"copies", {"label", "isbn", "status", NULL}, exportCopies},
+    {"loans", {"studentID", "label", "type", "date", NULL}, exportLoans},
+    {"unreturned", {"id", "firstName", "lastName", NULL}, exportUnreturned},
+    {"overdue", {"label", "studentID", "loanDate", "days", "returned", NULL}, exportOverdue},
+    {"penalized", {"id", "firstName", "lastName", "lateDays", NULL}, exportPenalized},
+};
 
-    while (curr) {
-        if (strcmp(curr->isbn, isbn) == 0) {
-            if (prev) prev->next = curr->next;
-            else head = curr->next;
+int parseExportFormat(const char* name, ExportFormat* format) {
+    if (strcmp(name, "csv") == 0) *format = EXPORT_CSV;
+    else if (strcmp(name, "jsonl") == 0) *format = EXPORT_JSONL;
+    else return 0;
+    return 1;
+}
 
-            // free copies
-            BookCopy* c = curr->copies;
-            while (c) {
-                BookCopy* temp = c;
-                c = c->next;
-                free(temp);
-            }
-            free(curr);
-            return head;
-        }
-        prev = curr;
-        curr = curr->next;
+// Writes rows offset.. offset+limit-1 of a report (limit -1 = to the end)
+// to path, or to the output if path is "-". A file is replaced only once
+// the export is complete. Returns the number of rows written, or -1.
+long exportReport(Library* lib, const char* report, ExportFormat format, const char* path, long offset, long limit) {
+    double start = wallClock();
+    ExportReport* r = NULL;
+    int i;
+    for (i = 0; i < (int)(sizeof(exportReports) / sizeof(ExportReport)); i++) {
+        if (strcmp(exportReports[i].name, report) == 0) r = &exportReports[i];
+    }
+    if (!r) {
+        fprintf(OUT, "Unknown report: %s\n", report);
+        return -1;
     }
 
-    return head; // not found
-}
-
-int updateBookTitle(Book* head, const char* isbn, const char* newTitle) {
-    while (head) {
-        if (strcmp(head->isbn, isbn) == 0) {
-            strcpy(head->title, newTitle);
-            return 1;
-        }
-        head = head->next;
+    int toOutput = strcmp(path, "-") == 0;
+    Exporter e = {NULL, format, r->columns, 0, offset < 0 ? 0 : offset, limit, 0, 0, 0, NULL, 0, 0};
+    e.buffer = malloc(EXPORT_BUFFER_SIZE);
+    e.out = !e.buffer ? NULL : toOutput ? OUT : openReplacement(path, "wb");
+    if (!e.out) {
+        fprintf(OUT, "Couldn't write %s\n", path);
+        free(e.buffer);
+        return -1;
+    }
+
+    if (format == EXPORT_CSV) {
+        for (i = 0; r->columns[i]; i++) exportText(&e, r->columns[i]);
+        *exportReserve(&e, 1) = '\n';
+        e.used++;
     }
-    return 0;
-}
-int bookExists(Book* head, const char* isbn) {
-    while (head) {
-        if (strcmp(head->isbn, isbn) == 0)
-            return 1;
-        head = head->next;
+    r->rows(lib, &e);
+    exportFlush(&e);
+    free(e.buffer);
+
+    if (toOutput) {
+        fflush(e.out);
+    } else if (!commitReplacement(e.out, path)) {
+        e.failed = 1;
     }
-    return 0;
+    recordMetric(METRIC_EXPORT, start, e.flushed, e.seen);
+    if (e.failed) {
+        fprintf(OUT, "Couldn't write %s\n", path);
+        return -1;
+    }
+    return e.written;
 }
 
+void exportMenu(Library* lib) {
+    char report[20], formatName[10], path[256];
+    long offset, limit;
+    ExportFormat format;
+    int i;
 
-void writeBooksToFile(Book* head) {
-    FILE* file = fopen("Kitaplar.csv", "w");
-    while (head) {
-        fprintf(file, "%s,%s,%d\n", head->title, head->isbn, head->quantity);
-        BookCopy* copy = head->copies;
-        while (copy) {
-            fprintf(file, "%s,%s\n", copy->label, copy->status);
-            copy = copy->next;
-        }
-        head = head->next;
+    printf("\nReports:");
+    for (i = 0; i < (int)(sizeof(exportReports) / sizeof(ExportReport)); i++) printf(" %s", exportReports[i].name);
+    printf("\nReport: ");
+    scanf("%19s", report);
+    printf("Format (csv/jsonl): ");
+    scanf("%9s", formatName);
+    if (!parseExportFormat(formatName, &format)) {
+        printf("Unknown format: %s\n", formatName);
+        return;
     }
-    fclose(file);
+    printf("File: ");
+    scanf("%255s", path);
+    printf("Skip rows: ");
+    if (scanf("%ld", &offset) != 1) offset = 0;
+    printf("Rows to export (-1 = all): ");
+    if (scanf("%ld", &limit) != 1) limit = -1;
+
+    lockLibrary(0);
+    long written = exportReport(lib, report, format, path, offset, limit);
+    unlockLibrary();
+    if (written >= 0 && strcmp(path, "-") != 0) printf("%ld row(s) exported to %s.\n", written, path);
 }
 
-Book* readBooksFromFile() {
-    FILE* file = fopen("Kitaplar.csv", "r");
-    if (!file) return NULL;
+// =================== Bulk Import ===================
+// Adds students, books, extra copies or book-author mappings from an
+// external CSV file in one pass. Rows whose key is already known (student
+// ID, ISBN, copy label, ISBN + author ID) are skipped, repeats within the
+// file included, so an import can safely be run again. Rows are only added
+// in memory and flagged; the files are saved once, after the whole import.
+//
+//   students  ID,FIRST,LAST[,POINTS]  the Ogrenciler.csv format
+//   books     TITLE,ISBN,QUANTITY     the book lines of Kitaplar.csv
+//   copies    ISBN_N                  copy labels of existing books
+//   mappings  ISBN,AUTHOR_ID          book and author must exist
+#define IMPORT_MAX_QUANTITY 10000 // copies one imported book line may create
 
-    char line[256];
-    Book* bookList = NULL;
-    Book* currentBook = NULL;
+typedef struct {
+    long added;
+    long duplicates;
+    long invalid;  // malformed lines (a header line counts here)
+} ImportCounts;
 
-    while (fgets(line, sizeof(line), file)) {
-        // Check if line contains book info or copy info
-        if (strchr(line, ',') && !strchr(line, '_')) {
-            // New book entry
-            Book* b = malloc(sizeof(Book));
-            sscanf(line, " %99[^,],%13[^,],%d", b->title, b->isbn, &b->quantity);
-            b->copies = NULL;
-            b->next = NULL;
+int isDigits(const char* s) {
+    return *s && s[strspn(s, "0123456789")] == '\0';
+}
 
-            if (!bookList) bookList = currentBook = b;
-            else {
-                currentBook->next = b;
-                currentBook = b;
-            }
-        } else if (currentBook != NULL) {
-            // BookCopy entry
-            BookCopy* c = malloc(sizeof(BookCopy));
-            sscanf(line, "%[^,],%s", c->label, c->status);
-            c->next = NULL;
-
-            if (!currentBook->copies) currentBook->copies = c;
-            else {
-                BookCopy* copyTail = currentBook->copies;
-                while (copyTail->next) copyTail = copyTail->next;
-                copyTail->next = c;
-            }
-        }
-    }
+// Reads the decimal number at s, which must run up to the end of the
+// string or one of the characters in ends and lie within min..max.
+int parseNumberField(const char* s, const char* ends, long min, long max, long* value) {
+    char* end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (end == s || (*end && !strchr(ends, *end)) || errno == ERANGE || v < min || v > max) return 0;
+    *value = v;
+    return 1;
+}
 
-    fclose(file);
-    return bookList;
+// Each returns 1 if the row was added, 0 for a duplicate, -1 if invalid.
+int importStudent(Library* lib, const char* line) {
+    char id[9], first[50], last[50];
+    int points = 100;
+    if (sscanf(line, "%8[^,],%49[^,],%49[^,\r\n],%d", id, first, last, &points) < 3 || !isDigits(id)) return -1;
+    if (findStudent(id)) return 0;
+    lib->students = addStudent(lib->students, id, first, last);
+    lastStudent->points = points;
+    studentsChanged = 1;
+    return 1;
 }
-void showBookInfoByTitle(Book* head, const char* title) {
-    while (head) {
-        if (strcmp(head->title, title) == 0) {
-            printf("Title: %s, ISBN: %s, Quantity: %d\n", head->title, head->isbn, head->quantity);
-            BookCopy* c = head->copies;
-            while (c) {
-                printf("  Copy: %s | Status: %s\n", c->label, c->status);
-                c = c->next;
-            }
-            return;
+
+int importBook(Library* lib, const char* line) {
+    char title[100], isbn[14];
+    long quantity;
+    int at = 0;
+    if (sscanf(line, " %99[^,],%13[^,],%n", title, isbn, &at) != 2 || at == 0 || !isDigits(isbn) ||
+        !parseNumberField(line + at, ",\r\n", 0, IMPORT_MAX_QUANTITY, &quantity)) return -1;
+    if (findBook(isbn)) return 0;
+    lib->books = addBook(lib->books, title, isbn, quantity);
+    booksChanged = 1;
+    return 1;
+}
+
+int importCopy(Library* lib, const char* line) {
+    char label[30], isbn[14];
+    long copy;
+    if (sscanf(line, "%29[^,\r\n]", label) != 1) return -1;
+    const char* sep = strrchr(label, '_');
+    if (!sep || sep == label || sep - label > 13 || !isDigits(sep + 1) || sep[1] == '0' ||
+        !parseNumberField(sep + 1, "", 1, INT_MAX, &copy)) return -1;
+    memcpy(isbn, label, sep - label);
+    isbn[sep - label] = '\0';
+    Book* b = findBook(isbn);
+    if (!b) return -1;
+    if (findCopyByLabel(label, NULL)) return 0;
+
+    // The dirty queue points into the copy array: take the book's entries
+    // out while it moves and put them back after.
+    int i;
+    unmarkBookDirty(b);
+    b->copies = realloc(b->copies, (b->copyCount + 1) * sizeof(BookCopy));
+    b->copies[b->copyCount].number = (int)copy;
+    b->copies[b->copyCount].holder = 0;
+    b->copies[b->copyCount].dirty = 0;
+    b->copyCount++;
+    b->quantity++;
+    for (i = 0; i < b->copyCount; i++) {
+        if (b->copies[i].dirty) {
+            b->copies[i].dirty = 0;
+            markCopyDirty(b, &b->copies[i]);
         }
-        head = head->next;
     }
-    printf("Book not found.\n");
+    buildShelfBitmap(b);
+    booksChanged = 1;
+    return 1;
 }
-void listBooksOnShelf(Book* head) {
-    printf("\n--- Books on Shelf ---\n");
-    while (head) {
-        BookCopy* c = head->copies;
-        while (c) {
-            if (strcmp(c->status, "RAFTA") == 0) {
-                printf("Book: %s | Copy: %s\n", head->title, c->label);
-            }
-            c = c->next;
-        }
-        head = head->next;
+
+int importMapping(Library* lib, const char* line) {
+    char isbn[14];
+    int authorID;
+    if (sscanf(line, "%13[^,],%d", isbn, &authorID) != 2 || !findBook(isbn) || !findAuthor(authorID)) return -1;
+    BookAuthor* m;
+    for (m = firstAuthorOf(isbn); m != NULL; m = m->nextForBook) {
+        if (m->authorID == authorID) return 0;
     }
+    addBookAuthorMapping(&lib->manager, isbn, authorID);
+    mappingsChanged = 1;
+    return 1;
 }
-LoanRecord* readLoansFromFile() {
-    FILE* file = fopen("LoanRecords.csv", "r");
-    if (!file) return NULL;
 
-    LoanRecord* head = NULL;
-    LoanRecord* tail = NULL;
-    char line[200];
+typedef struct {
+    const char* name;
+    int (*row)(Library*, const char*);
+} ImportKind;
+
+ImportKind importKinds[] = {
+    {"students", importStudent},
+    {"books", importBook},
+    {"copies", importCopy},
+    {"mappings", importMapping},
+};
 
-    while (fgets(line, sizeof(line), file)) {
-        LoanRecord* record = malloc(sizeof(LoanRecord));
-        sscanf(line, "%8[^,],%29[^,],%d,%10[^\n]",
-               record->studentID, record->label, &record->type, record->date);
-        record->next = NULL;
+// Returns 0 if the kind is unknown or the file can't be read.
+int importFile(Library* lib, const char* kind, const char* path, ImportCounts* counts) {
+    double start = wallClock();
+    ImportKind* k = NULL;
+    int i;
+    for (i = 0; i < (int)(sizeof(importKinds) / sizeof(ImportKind)); i++) {
+        if (strcmp(importKinds[i].name, kind) == 0) k = &importKinds[i];
+    }
+    if (!k) {
+        fprintf(OUT, "Unknown import: %s (use students, books, copies or mappings)\n", kind);
+        return 0;
+    }
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(OUT, "Couldn't open %s\n", path);
+        return 0;
+    }
 
-        if (!head) head = tail = record;
-        else {
-            tail->next = record;
-            tail = record;
-        }
+    char line[256];
+    memset(counts, 0, sizeof(*counts));
+    while (fgets(line, sizeof(line), f)) {
+        if (line[strspn(line, " \t\r\n")] == '\0') continue;
+        int result = k->row(lib, line);
+        if (result > 0) counts->added++;
+        else if (result == 0) counts->duplicates++;
+        else counts->invalid++;
     }
+    fclose(f);
+    recordMetric(METRIC_IMPORT, start, 0, counts->added + counts->duplicates + counts->invalid);
+    return 1;
+}
 
-    fclose(file);
-    return head;
+void printImportCounts(const char* path, const ImportCounts* counts) {
+    fprintf(OUT, "%s: %ld added, %ld duplicate(s) skipped, %ld invalid line(s).\n",
+            path, counts->added, counts->duplicates, counts->invalid);
 }
 
-//time functions 
+void importMenu(Library* lib) {
+    char kind[20], path[256];
+    ImportCounts counts;
+    printf("\nImport (students/books/copies/mappings): ");
+    scanf("%19s", kind);
+    printf("File: ");
+    scanf("%255s", path);
+    lockLibrary(1);
+    int imported = importFile(lib, kind, path, &counts);
+    if (imported) flushLibrary(lib);
+    unlockLibrary();
+    if (imported) printImportCounts(path, &counts);
+}
 
-int daysBetween(const char* d1, const char* d2) {
-    struct tm tm1 = {0}, tm2 = {0};
-    sscanf(d1, "%d-%d-%d", &tm1.tm_mday, &tm1.tm_mon, &tm1.tm_year);
-    sscanf(d2, "%d-%d-%d", &tm2.tm_mday, &tm2.tm_mon, &tm2.tm_year);
-    tm1.tm_mon--; tm2.tm_mon--;
-    tm1.tm_year -= 1900; tm2.tm_year -= 1900;
-    time_t time1 = mktime(&tm1);
-    time_t time2 = mktime(&tm2);
-    return difftime(time2, time1) / (60 * 60 * 24);
+// =================== Batch Mode ===================
+
+// Wall-clock seconds, for throughput figures.
+double wallClock(void) {
+#ifndef _WIN32
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
 }
 
-void listOverdueBooks(LoanRecord* loans) {
-    printf("\n--- Overdue Books ---\n");
-    LoanRecord* l = loans;
-    while (l) {
-        if (l->type == 0) {  // Loan
-            int returned = 0;
-            LoanRecord* r = loans;
-            while (r) {
-                if (r->type == 1 &&
-                    strcmp(r->studentID, l->studentID) == 0 &&
-                    strcmp(r->label, l->label) == 0) {
-                    int days = daysBetween(l->date, r->date);
-                    if (days > 15) {
-                        printf("%s Overdue (%d day) | Student: %s\n", l->label, days, l->studentID);
-                    }
-                    returned = 1;
-                    break;
-                }
-                r = r->next;
-            }
-            if (!returned) {
-                // still not returned, compare with today
-                time_t t = time(NULL);
-                struct tm tm = *localtime(&t);
-                char today[11];
-                sprintf(today, "%02d-%02d-%04d", tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900);
-
-                int days = daysBetween(l->date, today);
-                if (days > 15) {
-                    printf("%s Still didnt return (%d day passed) | Student: %s\n", l->label, days, l->studentID);
-                }
-            }
-        }
-        l = l->next;
+// Persists everything changed since the last flush: new loan records are
+// appended to the journal, copy statuses are patched in place, and the
+// other files are rewritten only if something in them changed.
+void flushLibrary(Library* lib) {
+    lockWrites();
+    if (writePending(lib->students, lib->books, &lib->loans, booksChanged)) booksChanged = 0;
+    unlockWrites();
+    if (mappingsChanged) writeBookAuthorCSV(&lib->manager);
+    mappingsChanged = 0;
+}
+
+typedef int (*BatchCommandFunc)(Library*, char*);
+typedef struct {
+    const char* name;
+    const char* usage;
+    BatchCommandFunc func;
+    int shared; // only touches one student/book, runs under the shared lock
+} BatchCommand;
+
+int batch_borrow(Library* lib, char* args) {
+    char studentID[9], isbn[14], date[12]; // one spare: parseDate rejects what is left over
+    if (sscanf(args, "%8s %13s %11s", studentID, isbn, date) != 3) return -1;
+    return borrowBook(lib->students, lib->books, &lib->loans, studentID, isbn, date);
+}
+
+int batch_return(Library* lib, char* args) {
+    char studentID[9], label[30], date[12];
+    if (sscanf(args, "%8s %29s %11s", studentID, label, date) != 3) return -1;
+    return returnBook(lib->students, lib->books, &lib->loans, studentID, label, date);
+}
+
+int batch_addStudent(Library* lib, char* args) {
+    char id[9], first[50], last[50];
+    if (sscanf(args, "%8s %49s %49s", id, first, last) != 3) return -1;
+    if (studentExists(lib->students, id)) {
+        fprintf(OUT, "Student %s already exists.\n", id);
+        return 0;
     }
+    lib->students = addStudent(lib->students, id, first, last);
+    studentsChanged = 1;
+    return 1;
 }
 
-// =================== Loan Record Functions ===================
-LoanRecord* addLoanRecord(LoanRecord* head, const char* studentID, const char* label, int type, const char* date) {
-    LoanRecord* newRec = malloc(sizeof(LoanRecord));
-    strcpy(newRec->studentID, studentID);
-    strcpy(newRec->label, label);
-    newRec->type = type;
-    strcpy(newRec->date, date);
-    newRec->next = NULL;
+int batch_addBook(Library* lib, char* args) {
+    char isbn[14], title[100];
+    int quantity, consumed = 0;
+    if (sscanf(args, "%13s %d %n", isbn, &quantity, &consumed) != 2 || consumed == 0) return -1;
+    if (sscanf(args + consumed, "%99[^\n]", title) != 1 || quantity < 0) return -1;
+    if (bookExists(lib->books, isbn)) {
+        fprintf(OUT, "Book %s already exists.\n", isbn);
+        return 0;
+    }
+    lib->books = addBook(lib->books, title, isbn, quantity);
+    booksChanged = 1;
+    return 1;
+}
 
-    if (!head) return newRec;
+int batch_map(Library* lib, char* args) {
+    char isbn[14];
+    int authorID;
+    if (sscanf(args, "%13s %d", isbn, &authorID) != 2) return -1;
+    addBookAuthorMapping(&lib->manager, isbn, authorID);
+    mappingsChanged = 1;
+    return 1;
+}
 
-    LoanRecord* tail = head;
-    while (tail->next) tail = tail->next;
-    tail->next = newRec;
-    return head;
+int batch_flush(Library* lib, char* args) {
+    flushLibrary(lib);
+    return 1;
 }
 
+int batch_showStudent(Library* lib, char* args) {
+    char id[9];
+    if (sscanf(args, "%8s", id) != 1) return -1;
+    lockCommit(); // the list head is set by the first loan ever recorded
+    LoanRecord* loans = lib->loans;
+    unlockCommit();
+    showStudentInfo(lib->students, loans, id);
+    return findStudent(id) != NULL;
+}
 
-void writeLoansToFile(LoanRecord* head) {
-    FILE* file = fopen("LoanRecords.csv", "w");
-    while (head) {
-        fprintf(file, "%s,%s,%d,%s\n", head->studentID, head->label, head->type, head->date);
-        head = head->next;
-    }
-    fclose(file);
+int batch_showBook(Library* lib, char* args) {
+    char title[100];
+    if (sscanf(args, "%99[^\n]", title) != 1) return -1;
+    showBookInfoByTitle(lib->books, title);
+    return 1;
 }
 
-// before main functions 
+int batch_search(Library* lib, char* args) {
+    char query[100];
+    if (sscanf(args, "%99[^\n]", query) != 1) return -1;
+    searchBooks(lib->books, query);
+    return 1;
+}
 
-void showStudentMenu(StudentOperation* ops, int opCount, Student** list, LoanRecord** loanList, Book* bookList) {
-    int choice;
-    while (1) {
-        printf("\n--- STUDENT OPERATIONS ---\n");
-        int i;
-		for (i = 0; i < opCount; ++i)
-            printf("%d. %s\n", ops[i].option, ops[i].label);
-        printf("0. Back\nChoice: ");
-        scanf("%d", &choice);
-        getchar();
+int batch_compact(Library* lib, char* args) {
+    char date[12];
+    if (sscanf(args, "%11s", date) != 1 || parseDate(date) == INVALID_DAY) return -1;
+    long archived = compactLoanHistory(&lib->loans, parseDate(date));
+    if (archived < 0) return 0;
+    fprintf(OUT, "%ld loan(s) moved to the archive.\n", archived);
+    return 1;
+}
 
-        if (choice == 0) break;
+int batch_history(Library* lib, char* args) {
+    char id[9];
+    if (sscanf(args, "%8s", id) != 1) return -1;
+    showArchivedLoans(id);
+    return 1;
+}
 
-        int found = 0;
-        for ( i = 0; i < opCount; ++i) {
-            if (ops[i].option == choice) {
-                ops[i].func(list, loanList, bookList);
-                found = 1;
-                break;
-            }
-        }
-        if (!found) printf("Invalid choice.\n");
-    }
+int batch_export(Library* lib, char* args) {
+    char report[20], formatName[10], path[200];
+    long offset = 0, limit = -1;
+    ExportFormat format;
+    if (sscanf(args, "%19s %9s %199s %ld %ld", report, formatName, path, &offset, &limit) < 3) return -1;
+    if (!parseExportFormat(formatName, &format)) return -1;
+    long written = exportReport(lib, report, format, path, offset, limit);
+    if (written < 0) return 0;
+    if (strcmp(path, "-") != 0) fprintf(OUT, "%ld row(s) exported to %s.\n", written, path);
+    return 1;
 }
 
+int batch_import(Library* lib, char* args) {
+    char kind[20], path[200];
+    ImportCounts counts;
+    if (sscanf(args, "%19s %199s", kind, path) != 2) return -1;
+    if (!importFile(lib, kind, path, &counts)) return 0;
+    printImportCounts(path, &counts);
+    return 1;
+}
 
-//author void menu before main
+int batch_stats(Library* lib, char* args) {
+    printStatistics(OUT, 0);
+    return 1;
+}
 
-void showAuthorMenu(AuthorOperation* ops, int opCount, Author** list, BookAuthorManager* manager, Book* bookList) {
-    int choice;
-    while (1) {
-        printf("\n--- AUTHOR OPERATIONS ---\n");
-        int i;
-		for (i = 0; i < opCount; ++i)
-            printf("%d. %s\n", ops[i].option, ops[i].label);
-        printf("0. Back\nChoice: ");
-        scanf("%d", &choice);
-        getchar();
+int batch_shelf(Library* lib, char* args) {
+    listBooksOnShelf(lib->books);
+    return 1;
+}
 
-        if (choice == 0) break;
+BatchCommand batchCommands[] = {
+    {"borrow", "borrow STUDENT_ID ISBN DD-MM-YYYY", batch_borrow, 1},
+    {"return", "return STUDENT_ID LABEL DD-MM-YYYY", batch_return, 1},
+    {"student", "student ID", batch_showStudent, 1},
+    {"book", "book TITLE...", batch_showBook, 1},
+    {"search", "search TEXT...", batch_search, 1},
+    {"shelf", "shelf", batch_shelf, 1},
+    {"addstudent", "addstudent ID FIRST LAST", batch_addStudent, 0},
+    {"addbook", "addbook ISBN QUANTITY TITLE...", batch_addBook, 0},
+    {"map", "map ISBN AUTHOR_ID", batch_map, 0},
+    {"history", "history STUDENT_ID", batch_history, 1},
+    {"compact", "compact DD-MM-YYYY", batch_compact, 0},
+    {"flush", "flush", batch_flush, 0},
+    {"export", "export REPORT csv|jsonl FILE|- [OFFSET [LIMIT]]", batch_export, 0},
+    {"stats", "stats", batch_stats, 1},
+    {"import", "import students|books|copies|mappings FILE", batch_import, 0},
+};
 
-        int found = 0;
-        for (i = 0; i < opCount; ++i) {
-            if (ops[i].option == choice) {
-              ops[i].func(list, manager, bookList);
+// Applies one command line. Returns 1 on success, 0 if the operation was
+// refused, -1 for malformed or unknown commands.
+int runBatchCommand(Library* lib, char* line) {
+    char name[20];
+    int consumed = 0;
+    if (sscanf(line, "%19s %n", name, &consumed) != 1) return -1;
+    int i;
+    for (i = 0; i < (int)(sizeof(batchCommands) / sizeof(BatchCommand)); i++) {
+        if (strcmp(batchCommands[i].name, name) == 0) {
+            int shared = batchCommands[i].shared;
+            lockLibrary(!shared);
+            int result = batchCommands[i].func(lib, line + consumed);
+            // Structural commands only flag what changed; unless a batch
+            // is deferring writes, persist it while we still hold the lock.
+            if (!shared && !deferWrites) flushLibrary(lib);
+            unlockLibrary();
+            if (result < 0) fprintf(OUT, "Usage: %s\n", batchCommands[i].usage);
+            return result;
+        }
+    }
+    fprintf(OUT, "Unknown command: %s\n", name);
+    return -1;
+}
 
-                found = 1;
-                break;
-            }
+// Reads commands from input, one per line ('#' starts a comment), and
+// applies them in order. Files are written every flushEvery commands
+// (0 = only at the end).
+int runBatch(Library* lib, FILE* input, long flushEvery) {
+    char line[256];
+    long lineNo = 0, commands = 0, succeeded = 0, failed = 0;
+    double start = wallClock();
+
+    // Under the library lock, like the flushes below: a SIGINT/SIGTERM
+    // flush (flushOnSignal) checks it from another thread
+    lockLibrary(1);
+    deferWrites = 1;
+    unlockLibrary();
+    while (fgets(line, sizeof(line), input)) {
+        lineNo++;
+        char* text = line + strspn(line, " \t");
+        text[strcspn(text, "\r\n")] = '\0';
+        if (*text == '#' || *text == '\0') continue;
+
+        int result = runBatchCommand(lib, text);
+        commands++;
+        if (result > 0) succeeded++;
+        else failed++;
+        printf("[%ld] %s -> %s\n", lineNo, text, result > 0 ? "OK" : result == 0 ? "FAILED" : "ERROR");
+
+        if (flushEvery > 0 && commands % flushEvery == 0) {
+            lockLibrary(1);
+            flushLibrary(lib);
+            unlockLibrary();
         }
+    }
+    lockLibrary(1);
+    flushLibrary(lib);
+    deferWrites = 0;
+    unlockLibrary();
+
+    double elapsed = wallClock() - start;
+    printf("\n%ld commands: %ld succeeded, %ld failed in %.3f s (%.0f commands/s)\n",
+           commands, succeeded, failed, elapsed, elapsed > 0 ? commands / elapsed : 0.0);
+    return failed == 0;
+}
 
-        if (!found)
-            printf("Invalid choice.\n");
+// =================== Daemon Mode ===================
+#ifndef _WIN32
+static Library* daemonLibrary;
+static const char* daemonSocket;
+
+// One thread per connection. The client sends the batch commands one per
+// line; every reply ends with a line that is exactly OK, FAILED or ERROR.
+void* serveClient(void* arg) {
+    int fd = (int)(ptrdiff_t)arg;
+    FILE* in = fdopen(fd, "r");
+    FILE* out = fdopen(dup(fd), "w");
+    if (!in || !out) {
+        if (in) fclose(in);
+        else close(fd);
+        if (out) fclose(out);
+        return NULL;
     }
+    replyStream = out;
+
+    char line[256];
+    while (fgets(line, sizeof(line), in)) {
+        char* text = line + strspn(line, " \t");
+        text[strcspn(text, "\r\n")] = '\0';
+        if (*text == '#' || *text == '\0') continue;
+        if (strcmp(text, "quit") == 0) break;
+
+        int result = runBatchCommand(daemonLibrary, text);
+        fprintf(out, "%s\n", result > 0 ? "OK" : result == 0 ? "FAILED" : "ERROR");
+        if (fflush(out) != 0) break; // client went away
+    }
+
+    replyStream = NULL;
+    fclose(out);
+    fclose(in);
+    return NULL;
 }
 
-//book show menu void 
+// Waits for SIGINT/SIGTERM, then saves a snapshot once no command is running.
+void* waitForShutdown(void* arg) {
+    sigset_t* signals = arg;
+    int sig;
+    sigwait(signals, &sig);
+
+    lockLibrary(1);
+    flushLibrary(daemonLibrary);
+    writeSnapshot(daemonLibrary);
+    writeStatistics();
+    unlink(daemonSocket);
+    printf("Daemon stopped.\n");
+    exit(0);
+}
 
-void showBookMenu(BookOperation* ops, int opCount, Book** bookList, LoanRecord** loanList, Author* authorList, BookAuthorManager* manager) {
-    int choice;
+// Async durability: writes whatever commits left pending, every interval.
+void* flushPeriodically(void* arg) {
+    Library* lib = arg;
+    struct timespec pause;
+    pause.tv_sec = (time_t)asyncFlushInterval;
+    pause.tv_nsec = (long)((asyncFlushInterval - pause.tv_sec) * 1e9);
     while (1) {
-        printf("\n--- BOOK OPERATIONS ---\n");
-        int i;
-		for ( i = 0; i < opCount; ++i)
-            printf("%d. %s\n", ops[i].option, ops[i].label);
-        printf("0. Back\nChoice: ");
-        scanf("%d", &choice);
-        getchar();
+        nanosleep(&pause, NULL);
+        lockLibrary(0);
+        lockWrites();
+        lockCommit();
+        int pending = commitsDurable < commitsMade;
+        unlockCommit();
+        if (pending) writePending(lib->students, lib->books, &lib->loans, 0);
+        unlockWrites();
+        unlockLibrary();
+    }
+    return NULL;
+}
 
-        if (choice == 0) break;
+int runDaemon(Library* lib, const char* path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Socket path too long: %s\n", path);
+        return 0;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
 
-        int found = 0;
-		for (i = 0; i < opCount; ++i) {
-            if (ops[i].option == choice) {
-                ops[i].func(bookList, loanList, authorList, manager);
-                found = 1;
-                break;
-            }
-        }
-        if (!found) printf("Invalid choice.\n");
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        printf("Couldn't create socket.\n");
+        return 0;
+    }
+    // A socket file nobody answers on is left over from a crash
+    if (connect(server, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        printf("Another daemon is already listening on %s\n", path);
+        close(server);
+        return 0;
+    }
+    close(server);
+    unlink(path);
+
+    server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0 || bind(server, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(server, 64) != 0) {
+        printf("Couldn't listen on %s\n", path);
+        if (server >= 0) close(server);
+        return 0;
     }
-}
 
+    daemonLibrary = lib;
+    daemonSocket = path;
+    initLocking();
+    signal(SIGPIPE, SIG_IGN);
+
+    // Client threads inherit this mask, so only the shutdown thread sees the signals
+    static sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, waitForShutdown, &signals) != 0) {
+        printf("Couldn't start the shutdown thread.\n");
+        close(server);
+        unlink(path);
+        return 0;
+    }
+    if (durability == DURABILITY_ASYNC && pthread_create(&thread, &attr, flushPeriodically, lib) != 0) {
+        printf("Couldn't start the flusher thread.\n");
+        close(server);
+        unlink(path);
+        return 0;
+    }
+
+    printf("Listening on %s\n", path);
+    fflush(stdout);
+    while (1) {
+        int client = accept(server, NULL, NULL);
+        if (client < 0) continue;
+        if (pthread_create(&thread, &attr, serveClient, (void*)(ptrdiff_t)client) != 0) close(client);
+    }
+}
+#endif
 
 // =================== Main Menu ===================
 void showMainMenu() {
@@ -1307,16 +5440,75 @@ void showMainMenu() {
     printf("2. Student Operations\n");
     printf("3. Book Operations\n");
     printf("4. Exit\n");
+    printf("5. Export a Report\n");
+    printf("6. Statistics\n");
+    printf("7. Import from CSV\n");
     printf("Choice: ");
 }
 
-int main() {
-    Author* authorList = readAuthorsFromFile();
-    Student* studentList = readStudentsFromFile();
-    Book* bookList = readBooksFromFile();
-    LoanRecord* loanList = readLoansFromFile();
-    BookAuthorManager manager = {NULL, 0};
-    readBookAuthorCSV(&manager);
+// benchmark.c includes this file with LIBRARY_NO_MAIN and brings its own main.
+#ifndef LIBRARY_NO_MAIN
+int main(int argc, char* argv[]) {
+    Library lib;
+
+    // Valid in every mode: --durability=sync|group|async, --flush-interval=SECONDS
+    int arg, kept = 1;
+    for (arg = 1; arg < argc; arg++) {
+        if (strncmp(argv[arg], "--durability=", 13) == 0) {
+            if (!setDurability(argv[arg] + 13)) {
+                printf("Unknown durability mode: %s (use sync, group or async)\n", argv[arg] + 13);
+                return 1;
+            }
+        } else if (strncmp(argv[arg], "--flush-interval=", 17) == 0) {
+            asyncFlushInterval = atof(argv[arg] + 17);
+            if (asyncFlushInterval <= 0) asyncFlushInterval = 1.0;
+        } else {
+            argv[kept++] = argv[arg];
+        }
+    }
+    argc = kept;
+    if (durability == DURABILITY_ASYNC && !(argc > 1 && strcmp(argv[1], "--daemon") == 0)) {
+        printf("--durability=async needs --daemon: only the daemon flushes pending commits on a timer.\n");
+        return 1;
+    }
+
+    // library --batch [FILE|-] [--flush-every=N]
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        const char* path = "-";
+        long flushEvery = 0;
+        int i;
+        for (i = 2; i < argc; i++) {
+            if (strncmp(argv[i], "--flush-every=", 14) == 0) flushEvery = atol(argv[i] + 14);
+            else path = argv[i];
+        }
+        FILE* input = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+        if (!input) {
+            printf("Couldn't open %s\n", path);
+            return 1;
+        }
+        loadLibrary(&lib);
+#ifndef _WIN32
+        catchStopSignals(&lib);
+#endif
+        int ok = runBatch(&lib, input, flushEvery);
+        if (input != stdin) fclose(input);
+        writeSnapshot(&lib);
+        writeStatistics();
+        return ok ? 0 : 2;
+    }
+
+#ifndef _WIN32
+    // library --daemon [SOCKET]
+    if (argc > 1 && strcmp(argv[1], "--daemon") == 0) {
+        loadLibrary(&lib);
+        return runDaemon(&lib, argc > 2 ? argv[2] : "library.sock") ? 0 : 1;
+    }
+#endif
+
+    loadLibrary(&lib);
+#ifndef _WIN32
+    catchStopSignals(&lib);
+#endif
 
     int choice;
     while (1) {
@@ -1326,21 +5518,39 @@ int main() {
 
         switch (choice) {
             case 1:
-                showAuthorMenu(authorOps, sizeof(authorOps)/sizeof(AuthorOperation), &authorList, &manager,bookList);
+                showAuthorMenu(authorOps, sizeof(authorOps)/sizeof(AuthorOperation), &lib.authors, &lib.manager, lib.books);
                 break;
             case 2:
-              showStudentMenu(studentOps, sizeof(studentOps)/sizeof(StudentOperation), &studentList, &loanList, bookList);
+              showStudentMenu(studentOps, sizeof(studentOps)/sizeof(StudentOperation), &lib.students, &lib.loans, lib.books);
                 break;
             case 3:
-                showBookMenu(bookOps, sizeof(bookOps)/sizeof(BookOperation), &bookList, &loanList, authorList, &manager);
+                showBookMenu(bookOps, sizeof(bookOps)/sizeof(BookOperation), &lib.books, &lib.loans, lib.authors, &lib.manager);
                 break;
             case 4:
+                lockLibrary(1);
+                flushLibrary(&lib); // anything a failed write left pending
+                writeSnapshot(&lib);
+                writeStatistics();
+                unlockLibrary();
                 printf("Exiting...\n");
                 return 0;
+            case 5:
+                exportMenu(&lib);
+                break;
+            case 6:
+                printf("\n");
+                lockLibrary(0);
+                printStatistics(stdout, 0);
+                unlockLibrary();
+                break;
+            case 7:
+                importMenu(&lib);
+                break;
             default:
                 printf("Invalid choice. Try again.\n");
         }
     }
 }
+#endif
 
 
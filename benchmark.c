@@ -0,0 +1,377 @@
+// Benchmark for the library system: generates a synthetic dataset in the
+// regular CSV formats, loads it and times the main operations.
+//
+// Build: gcc -O2 -pthread -o benchmark benchmark.c
+// Run:   ./benchmark --students=1000000 --books=200000 --copies=3 --loans=10000000
+//
+// All files are created inside --dir (default bench_data), never in the
+// current directory, so a real library's data is not touched.
+
+#define LIBRARY_NO_MAIN
+#include "Library_Management.c"
+
+#include <errno.h>
+
+// =================== SETTINGS ===================
+
+typedef struct {
+    const char* dir;
+    int students;
+    int books;
+    int copies;       // copies per book
+    long loans;       // loan + return records in the generated history
+    int ops;          // timed calls per transaction/lookup benchmark
+    int reportRuns;   // timed calls per report benchmark
+    unsigned int seed;
+} BenchConfig;
+
+// =================== HELPERS ===================
+
+static unsigned long long rngState;
+
+unsigned int benchRandom(void) {
+    // xorshift64*, reproducible for a given --seed
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (unsigned int)((rngState * 2685821657736338717ULL) >> 32);
+}
+
+// Reports print through stdout; while they are being timed it points at
+// /dev/null so the terminal is not the thing being measured.
+static int savedStdout = -1;
+
+void muteStdout(void) {
+    fflush(stdout);
+    savedStdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+}
+
+void unmuteStdout(void) {
+    fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+}
+
+int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Prints one result row; samples are per-call latencies in seconds.
+void reportTimings(const char* name, double* samples, int count) {
+    int i;
+    double total = 0;
+    for (i = 0; i < count; i++) total += samples[i];
+    qsort(samples, count, sizeof(double), compareDoubles);
+
+    printf("%-34s %8d %10.3f %12.1f %10.1f %10.1f %10.1f %10.1f\n",
+           name, count, total, total > 0 ? count / total : 0,
+           samples[count / 2] * 1e6,
+           samples[(int)(count * 0.90)] * 1e6,
+           samples[(int)(count * 0.99)] * 1e6,
+           samples[count - 1] * 1e6);
+}
+
+void reportSingle(const char* name, double seconds, long records) {
+    printf("%-34s %8d %10.3f %12.1f   (%ld records)\n",
+           name, 1, seconds, seconds > 0 ? records / seconds : 0, records);
+}
+
+// =================== DATASET GENERATION ===================
+
+static const char* firstNames[] = {
+    "Ali", "Ayse", "Mehmet", "Fatma", "Mustafa", "Emine", "Ahmet", "Hatice",
+    "Can", "Elif", "Deniz", "Zeynep", "Burak", "Selin", "Emre", "Merve"
+};
+static const char* lastNames[] = {
+    "Yilmaz", "Kaya", "Demir", "Sahin", "Celik", "Yildiz", "Yildirim", "Ozturk",
+    "Aydin", "Ozdemir", "Arslan", "Dogan", "Kilic", "Aslan", "Cetin", "Kara"
+};
+static const char* titleWords[] = {
+    "Silent", "River", "Garden", "Night", "Stone", "Winter", "Letters", "House",
+    "Memory", "Road", "Snow", "City", "Mountain", "Sea", "Dream", "Book"
+};
+#define NAME_COUNT(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+#define FIRST_STUDENT_ID 10000000
+#define FIRST_ISBN 9780000000000LL
+
+FILE* openOutput(const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot create %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+    return f;
+}
+
+// The loan history is simulated so that it is internally consistent: a copy
+// is only returned by the student holding it, and the copy statuses in
+// Kitaplar.csv match the loans still open at the end of the history.
+void generateDataset(const BenchConfig* cfg) {
+    long totalCopies = (long)cfg->books * cfg->copies;
+    int* holder = malloc(totalCopies * sizeof(int));      // student index or -1
+    long* openCopies = malloc(totalCopies * sizeof(long)); // copies currently out
+    long openCount = 0;
+    long i;
+    char date[11];
+
+    FILE* f = openOutput("Ogrenciler.csv");
+    for (i = 0; i < cfg->students; i++) {
+        fprintf(f, "%d,%s,%s,100\n", FIRST_STUDENT_ID + (int)i,
+                firstNames[benchRandom() % NAME_COUNT(firstNames)],
+                lastNames[benchRandom() % NAME_COUNT(lastNames)]);
+    }
+    fclose(f);
+
+    int authors = cfg->books / 3 > 0 ? cfg->books / 3 : 1;
+    f = openOutput("Yazarlar.csv");
+    for (i = 1; i <= authors; i++) {
+        fprintf(f, "%ld,%s,%s\n", i,
+                firstNames[benchRandom() % NAME_COUNT(firstNames)],
+                lastNames[benchRandom() % NAME_COUNT(lastNames)]);
+    }
+    fclose(f);
+
+    f = openOutput("KitapYazar.csv");
+    for (i = 0; i < cfg->books; i++) {
+        fprintf(f, "%lld,%u\n", FIRST_ISBN + i, 1 + benchRandom() % authors);
+        if (benchRandom() % 4 == 0) fprintf(f, "%lld,%u\n", FIRST_ISBN + i, 1 + benchRandom() % authors);
+    }
+    fclose(f);
+
+    // History runs over the last ~8 years up to today
+    for (i = 0; i < totalCopies; i++) holder[i] = -1;
+    int day = today() - 8 * 365;
+    long eventsPerDay = cfg->loans / (8 * 365) + 1;
+
+    f = openOutput("LoanRecords.csv");
+    for (i = 0; i < cfg->loans; i++) {
+        if (i % eventsPerDay == 0) day++;
+        formatDate(day, date);
+
+        int doReturn = openCount > 0 && (openCount == totalCopies || benchRandom() % 2 == 0);
+        if (doReturn) {
+            long slot = benchRandom() % openCount;
+            long copy = openCopies[slot];
+            openCopies[slot] = openCopies[--openCount];
+            fprintf(f, "%d,%lld_%ld,1,%s\n", FIRST_STUDENT_ID + holder[copy],
+                    FIRST_ISBN + copy / cfg->copies, copy % cfg->copies + 1, date);
+            holder[copy] = -1;
+        } else {
+            long copy = ((long)benchRandom() * 65536 + benchRandom() % 65536) % totalCopies;
+            while (holder[copy] >= 0) copy = (copy + 1) % totalCopies;
+            holder[copy] = benchRandom() % cfg->students;
+            openCopies[openCount++] = copy;
+            fprintf(f, "%d,%lld_%ld,0,%s\n", FIRST_STUDENT_ID + holder[copy],
+                    FIRST_ISBN + copy / cfg->copies, copy % cfg->copies + 1, date);
+        }
+    }
+    fclose(f);
+
+    f = openOutput("Kitaplar.csv");
+    for (i = 0; i < cfg->books; i++) {
+        fprintf(f, "%s %s %ld,%lld,%d\n",
+                titleWords[benchRandom() % NAME_COUNT(titleWords)],
+                titleWords[benchRandom() % NAME_COUNT(titleWords)], i,
+                FIRST_ISBN + i, cfg->copies);
+        int k;
+        for (k = 0; k < cfg->copies; k++) {
+            long copy = i * cfg->copies + k;
+            if (holder[copy] >= 0) fprintf(f, "%lld_%d,%d\n", FIRST_ISBN + i, k + 1, FIRST_STUDENT_ID + holder[copy]);
+            else fprintf(f, "%lld_%d,%-*s\n", FIRST_ISBN + i, k + 1, STATUS_FIELD_WIDTH, "RAFTA");
+        }
+    }
+    fclose(f);
+
+    free(holder);
+    free(openCopies);
+}
+
+// =================== BENCHMARKS ===================
+
+void randomStudentID(const BenchConfig* cfg, char* id) {
+    sprintf(id, "%d", FIRST_STUDENT_ID + (int)(benchRandom() % cfg->students));
+}
+
+void benchBorrow(const BenchConfig* cfg, Library* lib, const char* date) {
+    double* samples = malloc(cfg->ops * sizeof(double));
+    char id[12], isbn[14];
+    int i;
+    muteStdout();
+    for (i = 0; i < cfg->ops; i++) {
+        randomStudentID(cfg, id);
+        sprintf(isbn, "%lld", FIRST_ISBN + benchRandom() % cfg->books);
+        double start = wallClock();
+        borrowBook(lib->students, lib->books, &lib->loans, id, isbn, date);
+        samples[i] = wallClock() - start;
+    }
+    unmuteStdout();
+    reportTimings("borrowBook", samples, cfg->ops);
+    free(samples);
+}
+
+void benchReturn(const BenchConfig* cfg, Library* lib, const char* date) {
+    // Snapshot the open loans first: returning takes them off the heap
+    int count = openLoanCount < cfg->ops ? openLoanCount : cfg->ops;
+    if (count == 0) return;
+
+    char (*ids)[9] = malloc(count * sizeof(*ids));
+    char (*labels)[30] = malloc(count * sizeof(*labels));
+    double* samples = malloc(count * sizeof(double));
+    int i = 0;
+    for (i = 0; i < count; i++) {
+        strcpy(ids[i], openLoans[i]->studentID);
+        strcpy(labels[i], openLoans[i]->label);
+    }
+
+    muteStdout();
+    for (i = 0; i < count; i++) {
+        double start = wallClock();
+        returnBook(lib->students, lib->books, &lib->loans, ids[i], labels[i], date);
+        samples[i] = wallClock() - start;
+    }
+    unmuteStdout();
+    reportTimings("returnBook", samples, count);
+    free(ids);
+    free(labels);
+    free(samples);
+}
+
+void benchShowStudent(const BenchConfig* cfg, Library* lib) {
+    double* samples = malloc(cfg->ops * sizeof(double));
+    char id[12];
+    int i;
+    muteStdout();
+    for (i = 0; i < cfg->ops; i++) {
+        randomStudentID(cfg, id);
+        double start = wallClock();
+        showStudentInfo(lib->students, lib->loans, id);
+        samples[i] = wallClock() - start;
+    }
+    unmuteStdout();
+    reportTimings("showStudentInfo", samples, cfg->ops);
+    free(samples);
+}
+
+enum { REPORT_OVERDUE, REPORT_PENALIZED, REPORT_UNRETURNED, REPORT_ALL_BOOKS };
+
+void runReport(int report, Library* lib) {
+    switch (report) {
+        case REPORT_OVERDUE: listOverdueBooks(lib->loans); break;
+        case REPORT_PENALIZED: listPenalizedStudents(lib->students, lib->loans); break;
+        case REPORT_UNRETURNED: listStudentsWithUnreturnedBooks(lib->students, lib->loans); break;
+        case REPORT_ALL_BOOKS: op_listAllBooks(&lib->books, &lib->loans, lib->authors, &lib->manager); break;
+    }
+}
+
+void benchReport(const BenchConfig* cfg, Library* lib, int report, const char* name) {
+    double* samples = malloc(cfg->reportRuns * sizeof(double));
+    int i;
+    muteStdout();
+    for (i = 0; i < cfg->reportRuns; i++) {
+        double start = wallClock();
+        runReport(report, lib);
+        samples[i] = wallClock() - start;
+    }
+    unmuteStdout();
+    reportTimings(name, samples, cfg->reportRuns);
+    free(samples);
+}
+
+void benchSave(Library* lib, long records) {
+    double start = wallClock();
+    writeLoansToFile(lib->loans); // the journal before the copy statuses that depend on it
+    writeStudentsToFile(lib->students);
+    writeBooksToFile(lib->books);
+    writeAuthorsToFile(lib->authors);
+    writeBookAuthorCSV(&lib->manager);
+    reportSingle("save (all CSV files)", wallClock() - start, records);
+
+    start = wallClock();
+    writeSnapshot(lib);
+    reportSingle("save (snapshot)", wallClock() - start, records);
+}
+
+// =================== MAIN ===================
+
+int parseOption(const char* arg, const char* name, long* value) {
+    size_t len = strlen(name);
+    if (strncmp(arg, name, len) != 0 || arg[len] != '=') return 0;
+    *value = atol(arg + len + 1);
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    BenchConfig cfg = {"bench_data", 100000, 20000, 3, 50000, 2000, 3, 42};
+    int i;
+    for (i = 1; i < argc; i++) {
+        long v;
+        if (strncmp(argv[i], "--dir=", 6) == 0) cfg.dir = argv[i] + 6;
+        else if (parseOption(argv[i], "--students", &v)) cfg.students = (int)v;
+        else if (parseOption(argv[i], "--books", &v)) cfg.books = (int)v;
+        else if (parseOption(argv[i], "--copies", &v)) cfg.copies = (int)v;
+        else if (parseOption(argv[i], "--loans", &v)) cfg.loans = v;
+        else if (parseOption(argv[i], "--ops", &v)) cfg.ops = (int)v;
+        else if (parseOption(argv[i], "--report-runs", &v)) cfg.reportRuns = (int)v;
+        else if (parseOption(argv[i], "--seed", &v)) cfg.seed = (unsigned int)v;
+        else if (parseOption(argv[i], "--load-threads", &v)) loadThreads = (int)v;
+        else if (strncmp(argv[i], "--durability=", 13) == 0 && setDurability(argv[i] + 13)) continue;
+        else {
+            fprintf(stderr, "usage: %s [--dir=PATH] [--students=N] [--books=N] [--copies=N]\n"
+                            "       [--loans=N] [--ops=N] [--report-runs=N] [--seed=N]\n"
+                            "       [--load-threads=N] [--durability=sync|group|async]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.students < 1 || cfg.books < 1 || cfg.copies < 1 || cfg.ops < 1 || cfg.reportRuns < 1 ||
+        cfg.students > 89999999) {
+        fprintf(stderr, "Invalid dataset size.\n");
+        return 1;
+    }
+    rngState = 0x9E3779B97F4A7C15ULL ^ cfg.seed;
+
+    if (mkdir(cfg.dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create %s: %s\n", cfg.dir, strerror(errno));
+        return 1;
+    }
+    if (chdir(cfg.dir) != 0) {
+        fprintf(stderr, "Cannot enter %s: %s\n", cfg.dir, strerror(errno));
+        return 1;
+    }
+    remove(SNAPSHOT_FILE);
+
+    static const char* durabilityNames[] = {"sync", "group", "async"};
+    printf("Dataset: %d students, %d books x %d copies, %ld loan records (seed %u)\n",
+           cfg.students, cfg.books, cfg.copies, cfg.loans, cfg.seed);
+    printf("Durability: %s (borrow/return times include the journal writes it implies)\n",
+           durabilityNames[durability]);
+    double start = wallClock();
+    generateDataset(&cfg);
+    printf("Generated in %.2f s\n\n", wallClock() - start);
+
+    printf("%-34s %8s %10s %12s %10s %10s %10s %10s\n",
+           "operation", "calls", "total(s)", "ops/s", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+
+    long records = cfg.students + cfg.books + (long)cfg.books * cfg.copies + cfg.loans;
+    Library lib;
+    start = wallClock();
+    loadLibrary(&lib);
+    reportSingle("load (CSV files)", wallClock() - start, records);
+
+    char date[11];
+    formatDate(today() + 30, date);
+    benchBorrow(&cfg, &lib, date);
+    benchReturn(&cfg, &lib, date);
+    benchShowStudent(&cfg, &lib);
+    benchReport(&cfg, &lib, REPORT_OVERDUE, "listOverdueBooks");
+    benchReport(&cfg, &lib, REPORT_PENALIZED, "listPenalizedStudents");
+    benchReport(&cfg, &lib, REPORT_UNRETURNED, "listStudentsWithUnreturnedBooks");
+    benchReport(&cfg, &lib, REPORT_ALL_BOOKS, "op_listAllBooks");
+    benchSave(&lib, records);
+    return 0;
+}